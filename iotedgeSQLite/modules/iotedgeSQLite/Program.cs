@@ -1,6 +1,8 @@
 namespace SQLite
 {
     using System;
+    using System.Buffers;
+    using System.Collections.Concurrent;
     using System.Collections.Generic;
     using System.IO;
     using System.Runtime.InteropServices;
@@ -19,7 +21,10 @@ namespace SQLite
     class Program
     {
         const int DefaultPushInterval = 5000;
+        // timestamps in Parameters stay the strings the producer sent instead of becoming dates
+        static readonly JsonSerializerSettings CommandSettings = new JsonSerializerSettings { DateParseHandling = DateParseHandling.None };
         static int m_counter = 0;
+        static ModuleHandle m_moduleHandle = null;
 
         static void Main(string[] args)
         {
@@ -92,10 +97,12 @@ namespace SQLite
 
         /// <summary>
         /// This method is called whenever the module is sent a message from the EdgeHub. 
-        /// It just pipe the messages without any change.
+        /// It hands the command to the executor of its database and returns without waiting for it, the SDK calls it
+        /// for one message at a time. The executor completes the message once the command has run,
+        /// a database whose queue is full gets its message abandoned for redelivery instead of holding up the others.
         /// It prints all the incoming messages.
         /// </summary>
-        static async Task<MessageResponse> PipeMessage(Message message, object userContext)
+        static Task<MessageResponse> PipeMessage(Message message, object userContext)
         {
             Console.WriteLine("SQLite - Received command");
             int counterValue = Interlocked.Increment(ref m_counter);
@@ -113,57 +120,101 @@ namespace SQLite
             string messageString = Encoding.UTF8.GetString(messageBytes);
             Console.WriteLine($"Received message: {counterValue}, Body: [{messageString}]");
 
+            MessageResponse response = MessageResponse.Completed;
             message.Properties.TryGetValue("command-type", out string cmdType);
             if (cmdType == "SQLiteCmd")
             {
                 // Get message body, containing the write target and value
-                var messageBody = JsonConvert.DeserializeObject<SQLiteInMessage>(messageString);
+                var messageBody = JsonConvert.DeserializeObject<SQLiteInMessage>(messageString, CommandSettings);
+                // take the current set once, a reconfiguration swaps in a new one
+                var executors = moduleHandle.executors;
 
-                if (messageBody != null && moduleHandle.connections.ContainsKey(messageBody.DbName))
+                if (messageBody != null && messageBody.DbName != null && executors.TryGetValue(messageBody.DbName, out DataBaseExecutor executor))
                 {
-                    var connection = moduleHandle.connections[messageBody.DbName];
-                    using (var transaction = connection.BeginTransaction())
+                    string lockToken = message.LockToken;
+                    var posted = executor.TryPost(async owner =>
                     {
-                        var selectCommand = connection.CreateCommand();
-                        selectCommand.Transaction = transaction;
-                        //selectCommand.CommandText = "SELECT * FROM test;";
-                        selectCommand.CommandText = messageBody.Command;
-                        using (var reader = selectCommand.ExecuteReader())
+                        try
                         {
-                            if(reader.HasRows)
-                            {
-                                SQLiteOutMessage out_message = new SQLiteOutMessage();
-                                out_message.PublishTimestamp = DateTime.Now.ToString("yyyy-MM-dd HH:mm:ss");
-                                out_message.RequestId = messageBody.RequestId;
-                                out_message.RequestModule = messageBody.RequestModule;
-
-                                while (reader.Read())
-                                {
-                                    List<string> row = new List<string>();
-                                    int count = reader.FieldCount;
-                                    for(int i = 0; i<count; i++)
-                                    {
-                                        var value = reader.GetString(i);
-                                        row.Add(value);
-                                    }
-                                    out_message.Rows.Add(row);
-                                }
+                            await ExecuteCommand(owner, messageBody, ioTHubModuleClient);
+                        }
+                        finally
+                        {
+                            // a command that failed is logged by the executor, redelivering it would fail again
+                            await CompleteMessage(ioTHubModuleClient, lockToken);
+                        }
+                    });
+                    switch (posted)
+                    {
+                        case DataBaseExecutor.PostResult.Queued:
+                            // completed by the executor, the next message does not wait for this command
+                            response = MessageResponse.None;
+                            break;
+                        case DataBaseExecutor.PostResult.Full:
+                            Console.WriteLine($"Database {messageBody.DbName} is busy, command abandoned for redelivery");
+                            response = MessageResponse.Abandoned;
+                            break;
+                        default:
+                            Console.WriteLine($"Database {messageBody.DbName} was removed, command dropped");
+                            break;
+                    }
+                }
+            }
+            return Task.FromResult(response);
+        }
 
-                                //todo send back to sender module
-                                message = new Message(Encoding.ASCII.GetBytes(JsonConvert.SerializeObject(out_message)));
-                                message.Properties.Add("content-type", "application/edge-sqlite-json");
+        /// <summary>
+        /// Completes a message its handler left to the executor, a failure only means it is delivered again
+        /// </summary>
+        static async Task CompleteMessage(ModuleClient ioTHubModuleClient, string lockToken)
+        {
+            try
+            {
+                await ioTHubModuleClient.CompleteAsync(lockToken);
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine($"Exception while completing message, err message: {e.Message}");
+            }
+        }
 
-                                if (message != null)
-                                {
-                                    await ioTHubModuleClient.SendEventAsync("sqliteOutput", message);
-                                }
-                            }
+        /// <summary>
+        /// Runs one command on the executor of its database and sends back the rows it returns
+        /// </summary>
+        static async Task ExecuteCommand(DataBaseExecutor executor, SQLiteInMessage messageBody, ModuleClient ioTHubModuleClient)
+        {
+            using (var transaction = executor.Connection.BeginTransaction())
+            {
+                //selectCommand.CommandText = "SELECT * FROM test;";
+                var selectCommand = executor.GetCommand(messageBody.Command);
+                selectCommand.Transaction = transaction;
+                DataBaseExecutor.BindParameters(selectCommand, messageBody.Parameters);
+                SqliteDataReader reader;
+                try
+                {
+                    reader = selectCommand.ExecuteReader();
+                }
+                catch
+                {
+                    // a command that failed to prepare or run is not kept
+                    executor.ForgetCommand(messageBody.Command);
+                    throw;
+                }
+                using (reader)
+                {
+                    if(reader.HasRows)
+                    {
+                        //todo send back to sender module
+                        using (var body = SQLiteOutMessage.Write(messageBody, reader))
+                        using (var message = new Message(body))
+                        {
+                            message.Properties.Add("content-type", "application/edge-sqlite-json");
+                            await ioTHubModuleClient.SendEventAsync("sqliteOutput", message);
                         }
-                        transaction.Commit();
                     }
                 }
+                transaction.Commit();
             }
-            return MessageResponse.Completed;
         }
 
         /// <summary>
@@ -175,12 +226,7 @@ namespace SQLite
 
             try
             {
-                // stop all activities while updating configuration
-                await ioTHubModuleClient.SetInputMessageHandlerAsync(
-                "input1",
-                DummyCallBack,
-                null);
-
+                // messages keep flowing, only the databases and tables that changed are touched
                 await UpdateStartFromTwin(desiredProperties, ioTHubModuleClient);
             }
             catch (AggregateException ex)
@@ -258,16 +304,24 @@ namespace SQLite
 
                 if (config.IsValidate())
                 {
-                    moduleHandle = ModuleHandle.CreateHandleFromConfiguration(config);
-
-                    if (moduleHandle != null)
+                    if (m_moduleHandle != null)
                     {
-                        var userContext = new Tuple<ModuleClient, ModuleHandle>(ioTHubModuleClient, moduleHandle);
-                        // Register callback to be called when a message is received by the module
-                        await ioTHubModuleClient.SetInputMessageHandlerAsync(
-                        "input1",
-                        PipeMessage,
-                        userContext);
+                        m_moduleHandle.Reconfigure(config);
+                    }
+                    else
+                    {
+                        moduleHandle = ModuleHandle.CreateHandleFromConfiguration(config);
+
+                        if (moduleHandle != null)
+                        {
+                            m_moduleHandle = moduleHandle;
+                            var userContext = new Tuple<ModuleClient, ModuleHandle>(ioTHubModuleClient, moduleHandle);
+                            // Register callback to be called when a message is received by the module
+                            await ioTHubModuleClient.SetInputMessageHandlerAsync(
+                            "input1",
+                            PipeMessage,
+                            userContext);
+                        }
                     }
                 }
             }
@@ -303,45 +357,542 @@ namespace SQLite
                 command.ExecuteNonQuery();  
             }
         }
-        public Dictionary<string, SqliteConnection> connections = new Dictionary<string, SqliteConnection>();
+        public static SqliteConnection OpenDataBase(DataBase database)
+        {
+            var connection = new SqliteConnection("" +
+            new SqliteConnectionStringBuilder
+            {
+                DataSource = database.DbPath
+            });
+            try
+            {
+                connection.Open();
+
+                foreach(var tbl in database.Tables)
+                {
+                    TryCreateTable(connection, tbl.Value);
+                }
+            }
+            catch(Exception e)
+            {
+                Console.WriteLine($"Exception while opening database, err message: {e.Message}");
+                Console.WriteLine("Check if the database file is created or being mounted into the conainter correctly");
+            }
+            return connection;
+        }
+        private static HashSet<string> ExistingColumns(SqliteConnection connection, string tableName)
+        {
+            var ret = new HashSet<string>(StringComparer.OrdinalIgnoreCase);
+            using(var command = connection.CreateCommand())
+            {
+                command.CommandText = $"PRAGMA table_info({tableName});";
+                using(var reader = command.ExecuteReader())
+                {
+                    while (reader.Read())
+                    {
+                        ret.Add(reader.GetString(1));
+                    }
+                }
+            }
+            return ret;
+        }
+        /// <summary>
+        /// Adds the columns a changed table gained, SQLite cannot alter or drop columns in place so any other change is only logged
+        /// </summary>
+        private static void AlterTable(SqliteConnection connection, Table oldTable, Table tbl)
+        {
+            var existing = ExistingColumns(connection, tbl.TableName);
+            foreach(var column in tbl.Columns)
+            {
+                Column col = column.Value;
+                if (!existing.Contains(col.ColumnName))
+                {
+                    if (col.IsKey)
+                    {
+                        Console.WriteLine($"Table {tbl.TableName} must be rebuilt, key column {col.ColumnName} cannot be added");
+                        continue;
+                    }
+                    if (col.NotNull)
+                    {
+                        // existing rows have no value for it, so the constraint only comes with a rebuild
+                        Console.WriteLine($"Table {tbl.TableName} must be rebuilt to make {col.ColumnName} NOT NULL, adding it without");
+                    }
+                    using(var command = connection.CreateCommand())
+                    {
+                        command.CommandText = $"ALTER TABLE {tbl.TableName} ADD COLUMN {col.ColumnName} {col.Type};";
+                        command.ExecuteNonQuery();
+                    }
+                    Console.WriteLine($"Added column {col.ColumnName} to table {tbl.TableName}");
+                }
+                else if (oldTable != null && oldTable.Columns.TryGetValue(column.Key, out Column oldColumn) && !oldColumn.IsSameDefinition(col))
+                {
+                    Console.WriteLine($"Table {tbl.TableName} must be rebuilt to change column {col.ColumnName}, it is left as it is");
+                }
+            }
+            if (oldTable != null)
+            {
+                foreach(var column in oldTable.Columns)
+                {
+                    if (!tbl.Columns.ContainsKey(column.Key))
+                    {
+                        Console.WriteLine($"Table {tbl.TableName} must be rebuilt to drop column {column.Value.ColumnName}, it is left in place");
+                    }
+                }
+            }
+        }
+        public static void UpdateDataBase(SqliteConnection connection, DataBase oldDatabase, DataBase database)
+        {
+            foreach(var tbl in database.Tables)
+            {
+                if (!oldDatabase.Tables.TryGetValue(tbl.Key, out Table oldTable) || !oldTable.IsSameDefinition(tbl.Value))
+                {
+                    try
+                    {
+                        // a new or renamed table is created, one that is already there gets its new columns
+                        TryCreateTable(connection, tbl.Value);
+                        AlterTable(connection, (oldTable != null && oldTable.TableName == tbl.Value.TableName) ? oldTable : null, tbl.Value);
+                    }
+                    catch(Exception e)
+                    {
+                        Console.WriteLine($"Exception while updating table {tbl.Value.TableName}, err message: {e.Message}");
+                    }
+                }
+            }
+        }
+        // replaced as a whole, never modified, so PipeMessage can read it while a reconfiguration runs
+        public volatile Dictionary<string, DataBaseExecutor> executors = new Dictionary<string, DataBaseExecutor>();
+        // databases by DbPath as last configured
+        private Dictionary<string, DataBase> databases = new Dictionary<string, DataBase>();
         public static ModuleHandle CreateHandleFromConfiguration(ModuleConfig config)
         {
             ModuleHandle handle = new ModuleHandle();
+            handle.Reconfigure(config);
+            return handle;
+        }
+        /// <summary>
+        /// Applies a new configuration, keeping the connections of the databases that are still configured
+        /// </summary>
+        public void Reconfigure(ModuleConfig config)
+        {
+            var newExecutors = new Dictionary<string, DataBaseExecutor>();
+            var newDatabases = new Dictionary<string, DataBase>();
 
             foreach(var database in config.DataBases)
             {
-                var connection = new SqliteConnection("" +
-                new SqliteConnectionStringBuilder
+                string dbPath = database.Value.DbPath;
+                if (newExecutors.ContainsKey(dbPath))
                 {
-                    DataSource = database.Value.DbPath
-                });
+                    Console.WriteLine($"Database {dbPath} is configured more than once, only the first one is used");
+                }
+                else if (executors.TryGetValue(dbPath, out DataBaseExecutor executor))
+                {
+                    // queued behind the commands already waiting, on the executor's own connection
+                    DataBase oldDatabase = databases[dbPath];
+                    DataBase newDatabase = database.Value;
+                    executor.Post(owner =>
+                    {
+                        UpdateDataBase(owner.Connection, oldDatabase, newDatabase);
+                        return Task.CompletedTask;
+                    });
+                    newExecutors.Add(dbPath, executor);
+                    newDatabases.Add(dbPath, database.Value);
+                }
+                else
+                {
+                    Console.WriteLine($"Opening database {dbPath}");
+                    newExecutors.Add(dbPath, new DataBaseExecutor(database.Value));
+                    newDatabases.Add(dbPath, database.Value);
+                }
+            }
+
+            var oldExecutors = executors;
+            executors = newExecutors;
+            databases = newDatabases;
+
+            foreach(var executor in oldExecutors)
+            {
+                if (!newExecutors.ContainsKey(executor.Key))
+                {
+                    Console.WriteLine($"Closing database {executor.Key}");
+                    executor.Value.Dispose();
+                }
+            }
+        }
+    }
+    
+    /// <summary>
+    /// Owns the connection of one database and runs its commands in arrival order on a thread of its own,
+    /// so different databases are served in parallel
+    /// </summary>
+    class DataBaseExecutor : IDisposable
+    {
+        const int QueueCapacity = 256;
+        const int CommandCacheCapacity = 64;
+        readonly BlockingCollection<Func<DataBaseExecutor, Task>> queue = new BlockingCollection<Func<DataBaseExecutor, Task>>(QueueCapacity);
+        readonly SqliteConnection connection;
+        readonly Thread thread;
+        // prepared commands by text, most recently used first, only touched from the executor thread
+        readonly Dictionary<string, LinkedListNode<KeyValuePair<string, SqliteCommand>>> commands = new Dictionary<string, LinkedListNode<KeyValuePair<string, SqliteCommand>>>();
+        readonly LinkedList<KeyValuePair<string, SqliteCommand>> recentCommands = new LinkedList<KeyValuePair<string, SqliteCommand>>();
+
+        public SqliteConnection Connection => connection;
+
+        public DataBaseExecutor(DataBase database)
+        {
+            connection = ModuleHandle.OpenDataBase(database);
+            thread = new Thread(Run) { IsBackground = true, Name = $"sqlite {database.DbPath}" };
+            thread.Start();
+        }
+
+        /// <summary>
+        /// Queues work for the connection, blocking while the queue is full. Returns false once the executor is disposed.
+        /// </summary>
+        public bool Post(Func<DataBaseExecutor, Task> work)
+        {
+            bool ret = true;
+            try
+            {
+                queue.Add(work);
+            }
+            catch (ObjectDisposedException)
+            {
+                ret = false;
+            }
+            catch (InvalidOperationException)
+            {
+                ret = false;
+            }
+            return ret;
+        }
+
+        public enum PostResult
+        {
+            Queued,
+            Full,
+            Closed
+        }
+
+        /// <summary>
+        /// Queues work for the connection without waiting for room in the queue
+        /// </summary>
+        public PostResult TryPost(Func<DataBaseExecutor, Task> work)
+        {
+            PostResult ret;
+            try
+            {
+                ret = queue.TryAdd(work) ? PostResult.Queued : PostResult.Full;
+            }
+            catch (ObjectDisposedException)
+            {
+                // the handler read the executors before a reconfiguration disposed this one
+                ret = PostResult.Closed;
+            }
+            catch (InvalidOperationException)
+            {
+                // adding was completed, the executor is being disposed
+                ret = PostResult.Closed;
+            }
+            return ret;
+        }
+
+        void Run()
+        {
+            foreach (var work in queue.GetConsumingEnumerable())
+            {
                 try
                 {
-                    connection.Open();
+                    work(this).GetAwaiter().GetResult();
+                }
+                catch (Exception e)
+                {
+                    Console.WriteLine($"Exception while executing command, err message: {e.Message}");
+                }
+            }
+        }
 
-                    foreach(var tbl in database.Value.Tables)
+        /// <summary>
+        /// Returns the prepared command for the text, preparing it on first use and evicting the least recently used one when the cache is full
+        /// </summary>
+        public SqliteCommand GetCommand(string commandText)
+        {
+            if (commands.TryGetValue(commandText, out var node))
+            {
+                recentCommands.Remove(node);
+                recentCommands.AddFirst(node);
+            }
+            else
+            {
+                if (commands.Count >= CommandCacheCapacity)
+                {
+                    ForgetCommand(recentCommands.Last.Value.Key);
+                }
+                var command = connection.CreateCommand();
+                command.CommandText = commandText;
+                try
+                {
+                    command.Prepare();
+                }
+                catch
+                {
+                    command.Dispose();
+                    throw;
+                }
+                node = recentCommands.AddFirst(new KeyValuePair<string, SqliteCommand>(commandText, command));
+                commands.Add(commandText, node);
+            }
+            return node.Value.Value;
+        }
+
+        public void ForgetCommand(string commandText)
+        {
+            if (commands.TryGetValue(commandText, out var node))
+            {
+                commands.Remove(commandText);
+                recentCommands.Remove(node);
+                node.Value.Value.Dispose();
+            }
+        }
+
+        void ClearCommands()
+        {
+            foreach (var command in recentCommands)
+            {
+                command.Value.Dispose();
+            }
+            recentCommands.Clear();
+            commands.Clear();
+        }
+
+        /// <summary>
+        /// Sets the values of this call on the command, "name" binds to "@name"
+        /// </summary>
+        public static void BindParameters(SqliteCommand command, Dictionary<string, JToken> parameters)
+        {
+            foreach (SqliteParameter parameter in command.Parameters)
+            {
+                parameter.Value = DBNull.Value;
+            }
+            if (parameters != null)
+            {
+                foreach (var parameter in parameters)
+                {
+                    string name = parameter.Key;
+                    if (name.Length > 0 && name[0] != '@' && name[0] != '$' && name[0] != ':')
                     {
-                        TryCreateTable(connection, tbl.Value);
+                        name = "@" + name;
                     }
+                    object value = ParameterValue(parameter.Value);
+                    if (command.Parameters.Contains(name))
+                        command.Parameters[name].Value = value;
+                    else
+                        command.Parameters.AddWithValue(name, value);
                 }
-                catch(Exception e)
+            }
+        }
+
+        static object ParameterValue(JToken token)
+        {
+            object ret;
+            switch (token == null ? JTokenType.Null : token.Type)
+            {
+                case JTokenType.Null:
+                case JTokenType.Undefined:
+                    ret = DBNull.Value;
+                    break;
+                case JTokenType.Integer:
+                    ret = token.Value<long>();
+                    break;
+                case JTokenType.Float:
+                    ret = token.Value<double>();
+                    break;
+                case JTokenType.Boolean:
+                    ret = token.Value<bool>() ? 1L : 0L;
+                    break;
+                case JTokenType.String:
+                    ret = token.Value<string>();
+                    break;
+                default:
+                    // objects and arrays are stored as their JSON text
+                    ret = token.ToString(Formatting.None);
+                    break;
+            }
+            return ret;
+        }
+
+        /// <summary>
+        /// Finishes the queued work, then closes the connection
+        /// </summary>
+        public void Dispose()
+        {
+            queue.CompleteAdding();
+            thread.Join();
+            ClearCommands();
+            connection.Dispose();
+            queue.Dispose();
+        }
+    }
+
+    /// <summary>
+    /// A stream that appends to buffers rented from the shared pool and reads them back,
+    /// so a message body is neither regrown nor copied into an array of its own. Dispose returns the buffers.
+    /// </summary>
+    sealed class PooledStream : Stream
+    {
+        const int ChunkSize = 16 * 1024;
+        readonly List<byte[]> chunks = new List<byte[]>();
+        long length;
+        long position;
+
+        public override bool CanRead => true;
+        public override bool CanSeek => true;
+        public override bool CanWrite => true;
+        public override long Length => length;
+        public override long Position
+        {
+            get => position;
+            set => Seek(value, SeekOrigin.Begin);
+        }
+
+        /// <summary>
+        /// Writes always append, whatever the position
+        /// </summary>
+        public override void Write(byte[] buffer, int offset, int count)
+        {
+            while (count > 0)
+            {
+                int chunk = (int)(length / ChunkSize);
+                int at = (int)(length % ChunkSize);
+                if (chunk == chunks.Count)
                 {
-                    Console.WriteLine($"Exception while opening database, err message: {e.Message}");
-                    Console.WriteLine("Check if the database file is created or being mounted into the conainter correctly");
+                    chunks.Add(ArrayPool<byte>.Shared.Rent(ChunkSize));
                 }
+                int n = Math.Min(count, ChunkSize - at);
+                Buffer.BlockCopy(buffer, offset, chunks[chunk], at, n);
+                offset += n;
+                count -= n;
+                length += n;
+            }
+        }
 
-                handle.connections.Add(database.Value.DbPath, connection);
+        public override int Read(byte[] buffer, int offset, int count)
+        {
+            int ret = 0;
+            while (count > 0 && position < length)
+            {
+                int chunk = (int)(position / ChunkSize);
+                int at = (int)(position % ChunkSize);
+                int n = (int)Math.Min(Math.Min(count, ChunkSize - at), length - position);
+                Buffer.BlockCopy(chunks[chunk], at, buffer, offset, n);
+                offset += n;
+                count -= n;
+                position += n;
+                ret += n;
             }
-            return handle;
+            return ret;
+        }
+
+        public override long Seek(long offset, SeekOrigin origin)
+        {
+            long target = (origin == SeekOrigin.Begin) ? offset : (origin == SeekOrigin.Current) ? position + offset : length + offset;
+            if (target < 0 || target > length)
+            {
+                throw new ArgumentOutOfRangeException(nameof(offset));
+            }
+            position = target;
+            return position;
+        }
+
+        public override void SetLength(long value) => throw new NotSupportedException();
+        public override void Flush() { }
+
+        protected override void Dispose(bool disposing)
+        {
+            foreach (var chunk in chunks)
+            {
+                ArrayPool<byte>.Shared.Return(chunk);
+            }
+            chunks.Clear();
+            length = 0;
+            position = 0;
+            base.Dispose(disposing);
         }
     }
-    
-    class SQLiteOutMessage
+
+    /// <summary>
+    /// Writes {"PublishTimestamp","RequestId","RequestModule","Rows":[[...]]} straight from the reader.
+    /// Values are strings and NULL is null, unless the request sets TypedValues, then integers and reals
+    /// are JSON numbers and blobs base64.
+    /// </summary>
+    static class SQLiteOutMessage
     {
-        public string PublishTimestamp;
-        public int RequestId;
-        public string RequestModule;
-        public List<List<string>> Rows = new List<List<string>>();
+        class CharArrayPool : IArrayPool<char>
+        {
+            public static readonly CharArrayPool Instance = new CharArrayPool();
+            public char[] Rent(int minimumLength) => ArrayPool<char>.Shared.Rent(minimumLength);
+            public void Return(char[] array) => ArrayPool<char>.Shared.Return(array);
+        }
+        static readonly UTF8Encoding Utf8 = new UTF8Encoding(false);
+
+        /// <summary>
+        /// Returns the body positioned at its start, the caller disposes it once the message is sent
+        /// </summary>
+        public static PooledStream Write(SQLiteInMessage request, SqliteDataReader reader)
+        {
+            var stream = new PooledStream();
+            try
+            {
+                using (var streamWriter = new StreamWriter(stream, Utf8, 1024, true))
+                using (var writer = new JsonTextWriter(streamWriter) { ArrayPool = CharArrayPool.Instance })
+                {
+                    writer.WriteStartObject();
+                    writer.WritePropertyName("PublishTimestamp");
+                    writer.WriteValue(DateTime.Now.ToString("yyyy-MM-dd HH:mm:ss"));
+                    writer.WritePropertyName("RequestId");
+                    writer.WriteValue(request.RequestId);
+                    writer.WritePropertyName("RequestModule");
+                    writer.WriteValue(request.RequestModule);
+                    writer.WritePropertyName("Rows");
+                    writer.WriteStartArray();
+                    while (reader.Read())
+                    {
+                        writer.WriteStartArray();
+                        int count = reader.FieldCount;
+                        for(int i = 0; i<count; i++)
+                        {
+                            WriteCell(writer, reader, i, request.TypedValues);
+                        }
+                        writer.WriteEndArray();
+                    }
+                    writer.WriteEndArray();
+                    writer.WriteEndObject();
+                }
+                stream.Position = 0;
+            }
+            catch
+            {
+                stream.Dispose();
+                throw;
+            }
+            return stream;
+        }
+        static void WriteCell(JsonTextWriter writer, SqliteDataReader reader, int i, bool typed)
+        {
+            if (reader.IsDBNull(i))
+            {
+                writer.WriteNull();
+                return;
+            }
+            // the type of the value in the current row, SQLite columns are not typed
+            Type type = typed ? reader.GetFieldType(i) : typeof(string);
+            if (type == typeof(long))
+                writer.WriteValue(reader.GetInt64(i));
+            else if (type == typeof(double))
+                writer.WriteValue(reader.GetDouble(i));
+            else if (type == typeof(byte[]))
+                writer.WriteValue((byte[])reader.GetValue(i));
+            else
+                writer.WriteValue(reader.GetString(i));
+        }
     }
     class SQLiteInMessage
     {
@@ -349,6 +900,10 @@ namespace SQLite
         public string RequestModule;
         public string DbName;
         public string Command;
+        // optional values for the named parameters in Command
+        public Dictionary<string, JToken> Parameters;
+        // rows carry integers and reals as JSON numbers and blobs as base64 instead of strings
+        public bool TypedValues;
     }
     class ModuleConfig
     {
@@ -482,6 +1037,18 @@ namespace SQLite
     {        
         public string TableName;
         public Dictionary<string, Column> Columns;
+
+        public bool IsSameDefinition(Table other)
+        {
+            bool ret = TableName == other.TableName && Columns.Count == other.Columns.Count;
+            foreach (var column in Columns)
+            {
+                if (!ret)
+                    break;
+                ret = other.Columns.TryGetValue(column.Key, out Column otherColumn) && column.Value.IsSameDefinition(otherColumn);
+            }
+            return ret;
+        }
     }
     class Column
     {
@@ -489,5 +1056,10 @@ namespace SQLite
         public string Type;
         public bool IsKey;
         public bool NotNull;
+
+        public bool IsSameDefinition(Column other)
+        {
+            return ColumnName == other.ColumnName && Type == other.Type && IsKey == other.IsKey && NotNull == other.NotNull;
+        }
     }
 }
\ No newline at end of file
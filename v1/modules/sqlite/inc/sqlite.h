@@ -15,8 +15,32 @@
 #define handleDLL void *
 
 typedef struct SQLITE_COLUMN_TAG SQLITE_COLUMN;
+typedef struct SQLITE_INDEX_TAG SQLITE_INDEX;
 typedef struct SQLITE_SOURCE_TAG SQLITE_SOURCE;
 typedef struct SQLITE_CONFIG_TAG SQLITE_CONFIG;
+typedef struct SQLITE_RATE_STATE_TAG SQLITE_RATE_STATE;
+
+typedef struct SQLITE_LANE_CONFIG_TAG SQLITE_LANE_CONFIG;
+typedef struct SQLITE_MEMORY_CONFIG_TAG SQLITE_MEMORY_CONFIG;
+typedef struct SQLITE_HEAP_CONFIG_TAG SQLITE_HEAP_CONFIG;
+typedef struct SQLITE_SLOW_QUERY_CONFIG_TAG SQLITE_SLOW_QUERY_CONFIG;
+typedef struct SQLITE_MAINTENANCE_CONFIG_TAG SQLITE_MAINTENANCE_CONFIG;
+typedef struct SQLITE_BACKPRESSURE_CONFIG_TAG SQLITE_BACKPRESSURE_CONFIG;
+
+typedef enum SQLITE_RATE_POLICY_TAG
+{
+    SQLITE_RATE_DROP, //over the rate commands are discarded
+    SQLITE_RATE_REJECT, //over the rate commands are discarded and an error is published
+    SQLITE_RATE_COALESCE //the newest over the rate command is held and executed when the rate allows
+} SQLITE_RATE_POLICY;
+
+typedef enum SQLITE_LANE_ID_TAG
+{
+    SQLITE_LANE_INGEST,
+    SQLITE_LANE_INTERACTIVE,
+    SQLITE_LANE_BULK,
+    SQLITE_LANE_COUNT
+} SQLITE_LANE_ID;
 
 struct SQLITE_COLUMN_TAG
 {
@@ -26,9 +50,20 @@ struct SQLITE_COLUMN_TAG
     //default value
     int primaryKey;
     int notNull;
+    int fullText; //indexed in the table's FTS5 index when 1
     //row id
 };
 
+struct SQLITE_INDEX_TAG
+{
+    SQLITE_INDEX * p_next;
+    const char * name; //created as <table>_ix_<name>
+    const char * columns; //key columns, e.g. "MAC, DATETIME DESC"
+    const char * include; //extra columns appended to the key to cover queries, NULL for none
+    const char * where; //partial index condition, NULL for none
+    int unique;
+};
+
 struct SQLITE_SOURCE_TAG
 {
     SQLITE_SOURCE * p_next;
@@ -36,13 +71,91 @@ struct SQLITE_SOURCE_TAG
     const char * dbPath;
     const char * table;
     int limit;
+    int timeout; //execution deadline in ms for commands on this source, 0 means unbounded
     SQLITE_COLUMN * columns;
+    SQLITE_INDEX * indexes;
+    int partitionInterval; //seconds covered by each partition table, 0 when the table is not partitioned
+    int partitionKeep; //partitions kept, older ones are dropped
+    long long partitionCurrent; //partition receiving inserts, maintained by the module
+    long long partitionRetry; //time before which a failed rotation is not retried, maintained by the module
+    int rateCommands; //commands per second admitted from other modules, 0 for no limit
+    int rateBytes; //content bytes per second admitted from other modules, 0 for no limit
+    int rateBurst; //seconds of rate the buckets hold, 0 for the default
+    SQLITE_RATE_POLICY ratePolicy;
+    SQLITE_RATE_STATE * rateState; //buckets and counters, maintained by the module
+    size_t queued; //commands of the source waiting in the work queue, maintained by the module
+    double commitLatency; //moving average of the ms its commands take to execute, maintained by the module
+    int throttled; //1 between a throttle advisory and the following resume, maintained by the module
+};
+
+struct SQLITE_LANE_CONFIG_TAG
+{
+    int weight; //share of the executor relative to the other lanes, 0 when lanes are not configured
+    int latencyTarget; //ms a command may wait before its lane is served ahead of its share, 0 for none
+    int capacity; //commands the lane holds before it refuses new ones, 0 for the default
+};
+
+struct SQLITE_MEMORY_CONFIG_TAG
+{
+    sqlite3_int64 softHeapLimit; //bytes, 0 for no limit
+    sqlite3_int64 hardHeapLimit; //bytes, 0 for no limit
+    int cacheSize; //KiB of page cache per connection, 0 for the SQLite default
+    int releaseThreshold; //percent of the heap limit at which caches are released, 0 for the default
 };
 
+struct SQLITE_HEAP_CONFIG_TAG
+{
+    int size; //bytes of the fixed memsys5 heap given to SQLite, 0 for the system allocator
+    int minAllocation; //smallest memsys5 allocation in bytes, 0 for the default
+    int pageCacheSlot; //bytes per preallocated page cache slot
+    int pageCacheCount; //number of preallocated page cache slots, 0 for none
+    int arenaSize; //bytes of the per-message arena results are serialized into, 0 for the system allocator
+};
+
+struct SQLITE_SLOW_QUERY_CONFIG_TAG
+{
+    int threshold; //ms a command may take before it is logged with its query plan, 0 to disable
+    int ringSize; //slow commands kept for the "slowlog" request, 0 for the default
+    int sampleRate; //keep one in sampleRate slow commands in the ring, 0 or 1 for all
+};
+
+struct SQLITE_MAINTENANCE_CONFIG_TAG
+{
+    int interval; //seconds between maintenance passes over the database files, 0 when maintenance is not configured
+    int idleTime; //ms the work queues must stay empty before a slice runs, 0 for the default
+    int sliceBudget; //ms a maintenance slice may run, 0 for the default
+    int vacuumPages; //free pages returned to the file system per incremental_vacuum step, 0 for the default
+    int analysisLimit; //rows ANALYZE examines per index, 0 for the default
+    int rebuild; //1 to VACUUM files created without incremental auto_vacuum once at start, 0 to leave them
+};
+
+struct SQLITE_BACKPRESSURE_CONFIG_TAG
+{
+    int highBacklog; //queued commands of a source at which its producers are told to throttle, 0 to ignore the backlog
+    int lowBacklog; //queued commands at or below which they are told to resume, 0 for half the high watermark
+    int highLatency; //average ms a command of the source takes at which its producers are told to throttle, 0 to ignore latency
+    int lowLatency; //average ms at or below which they are told to resume, 0 for half the high watermark
+};
+
+/*a capture log is SQLITE_CAPTURE_MAGIC, written each time the module opens it, followed by one record per message:
+  uint64 microseconds since the magic, uint32 property count, uint32 content size,
+  then for each property uint32 key size, key, uint32 value size, value, and then the content, all integers little endian*/
+#define SQLITE_CAPTURE_MAGIC "SQLCAP01"
+#define SQLITE_CAPTURE_MAGIC_SIZE 8
+
 struct SQLITE_CONFIG_TAG
 {
     const char * mac_address;
     SQLITE_SOURCE * sources;
+    SQLITE_LANE_CONFIG lanes[SQLITE_LANE_COUNT];
+    SQLITE_MEMORY_CONFIG memory;
+    SQLITE_HEAP_CONFIG heap;
+    SQLITE_SLOW_QUERY_CONFIG slowQuery;
+    SQLITE_MAINTENANCE_CONFIG maintenance;
+    SQLITE_BACKPRESSURE_CONFIG backpressure;
+    int trace; //1 to time every command through receive, queue, execution and publish
+    const char * capture; //file every received message is appended to, NULL for none
+    int attach; //1 to keep one connection with the other configured database files attached under their source ids
 }; /*this needs to be passed to the Module_Create function*/
 
 #ifdef __cplusplus
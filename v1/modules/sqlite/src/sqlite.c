@@ -2,6 +2,14 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <limits.h>
+#endif
 #ifdef _CRTDBG_MAP_ALLOC
 #include <crtdbg.h>
 #endif
@@ -13,9 +21,157 @@
 #include "message.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/threadapi.h"
 
 #define BUFSIZE 1024
 #define MACSTRLEN 17
+#define PROGRESS_OPCODES 1000 //number of VM instructions between deadline checks
+#define LANE_STRIDE 1048576 //virtual time a lane of weight 1 is charged per request
+#define WORKER_IDLE_WAIT_MS 1000 //longest the idle worker waits for a command before it looks at its idle duties again
+#define DEFAULT_LANE_CAPACITY 1024 //commands a lane holds before it refuses new ones
+#define DEFAULT_RELEASE_THRESHOLD 90 //percent of the heap limit
+#define DEFAULT_MIN_ALLOCATION 64 //bytes, smallest memsys5 allocation
+#define ARENA_ALIGNMENT 16
+#define MAX_INIT_THREADS 8 //database files initialized at the same time by Sqlite_Start
+#define SCHEMA_VERSION 1 //bump when the generated DDL changes so every table is rebuilt
+#define SCHEMA_TABLE "gw_schema_fingerprint"
+#define DEFAULT_SEARCH_LIMIT 20
+#define DEFAULT_PAGE_SIZE 100 //rows per page of a range request
+#define MAX_AGGREGATE_COLUMNS 16
+#define DEFAULT_PARTITION_KEEP 7
+#define PARTITION_RETRY_SECONDS 60
+#define DEFAULT_RATE_BURST 1 //seconds of rate a bucket holds
+#define STMT_CACHE_SIZE 16 //prepared statements kept per connection
+#define DEFAULT_SLOW_RING_SIZE 32
+#define DEFAULT_MAINTENANCE_INTERVAL 3600 //seconds between maintenance passes
+#define DEFAULT_MAINTENANCE_IDLE_MS 1000
+#define DEFAULT_MAINTENANCE_SLICE_MS 50
+#define DEFAULT_VACUUM_PAGES 64
+#define DEFAULT_ANALYSIS_LIMIT 400
+#define TRACE_BUCKETS 32 //log2 buckets of microseconds
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+typedef struct SQLITE_ARENA_TAG
+{
+    unsigned char * buffer;
+    size_t size;
+    size_t used;
+    size_t highwater;
+    size_t fallbacks; //allocations that did not fit and went to the system allocator
+    int active; //set while a command executes, the arena is only reset between commands
+}SQLITE_ARENA;
+
+typedef enum SQLITE_TRACE_POINT_TAG
+{
+    SQLITE_TRACE_RECEIVED,
+    SQLITE_TRACE_DEQUEUED,
+    SQLITE_TRACE_EXEC_START,
+    SQLITE_TRACE_EXEC_END,
+    SQLITE_TRACE_SERIALIZED,
+    SQLITE_TRACE_PUBLISHED,
+    SQLITE_TRACE_POINT_COUNT
+}SQLITE_TRACE_POINT;
+
+typedef enum SQLITE_TRACE_STAGE_TAG
+{
+    SQLITE_TRACE_QUEUE, //received to dequeued
+    SQLITE_TRACE_DISPATCH, //dequeued to execution start
+    SQLITE_TRACE_EXEC,
+    SQLITE_TRACE_SERIALIZE, //execution end to the result ready for the broker
+    SQLITE_TRACE_PUBLISH, //Broker_Publish
+    SQLITE_TRACE_TOTAL,
+    SQLITE_TRACE_STAGE_COUNT
+}SQLITE_TRACE_STAGE;
+
+typedef struct SQLITE_TRACE_TAG
+{
+    uint64_t stamps[SQLITE_TRACE_POINT_COUNT]; //monotonic microseconds, 0 for a point the command did not reach
+}SQLITE_TRACE;
+
+typedef struct SQLITE_HISTOGRAM_TAG
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[TRACE_BUCKETS]; //bucket i counts durations below 2^i microseconds and not below 2^(i-1)
+}SQLITE_HISTOGRAM;
+
+typedef struct SQLITE_WORK_ITEM_TAG SQLITE_WORK_ITEM;
+
+struct SQLITE_RATE_STATE_TAG
+{
+    double commands; //tokens left in the command bucket
+    double bytes; //tokens left in the byte bucket, negative after a command larger than the bucket
+    tickcounter_ms_t refilled;
+    char * pending; //content of the command held by a coalescing source, NUL terminated, NULL for none
+    size_t pending_size;
+    CONSTMAP_HANDLE pending_properties; //of the held command, its answer is addressed from them
+    unsigned long admitted;
+    unsigned long dropped;
+    unsigned long rejected;
+    unsigned long coalesced; //held commands replaced by a newer one before they could run
+};
+
+struct SQLITE_WORK_ITEM_TAG
+{
+    SQLITE_WORK_ITEM * p_next;
+    JSON_Value * json;
+    SQLITE_SOURCE * source; //NULL for commands from IoTHub
+    const char * request_id;
+    tickcounter_ms_t enqueued;
+    SQLITE_TRACE trace;
+};
+
+typedef struct SQLITE_LANE_TAG
+{
+    SQLITE_WORK_ITEM * head;
+    SQLITE_WORK_ITEM * tail;
+    size_t depth;
+    size_t capacity;
+    size_t refused; //commands turned away because the lane was full
+    int weight;
+    int latency_target;
+    uint64_t virtual_time;
+    size_t target_misses;
+}SQLITE_LANE;
+
+typedef struct SQLITE_STMT_CACHE_ENTRY_TAG
+{
+    char * sql;
+    sqlite3_stmt * stmt;
+    uint64_t last_used;
+}SQLITE_STMT_CACHE_ENTRY;
+
+typedef struct SQLITE_SLOW_QUERY_TAG
+{
+    char * sql;
+    char * plan;
+    tickcounter_ms_t finished;
+    unsigned long long duration;
+    int rows;
+    int rc;
+}SQLITE_SLOW_QUERY;
+
+typedef enum SQLITE_MAINTENANCE_STEP_TAG
+{
+    SQLITE_MAINTENANCE_VACUUM,
+    SQLITE_MAINTENANCE_ANALYZE,
+    SQLITE_MAINTENANCE_OPTIMIZE
+}SQLITE_MAINTENANCE_STEP;
+
+typedef struct SQLITE_REQUEST_TAG
+{
+    const char * request_id;
+    const char * reply_to; //module the result is meant for, carried in the "target" property
+    const char * reply; //"none" to drop the result, "result" to answer a command from another module
+    int timeout;
+    int publish; //0 when the result is dropped
+    int local; //1 for commands from other modules, answered without the "macAddress" that routes to IoT Hub
+}SQLITE_REQUEST;
 
 typedef struct SQLITE_HANDLE_DATA_TAG
 {
@@ -23,8 +179,53 @@ typedef struct SQLITE_HANDLE_DATA_TAG
     BROKER_HANDLE broker;
     const char * mac_address;
     SQLITE_SOURCE * sources;
+    TICK_COUNTER_HANDLE tick_counter;
+    LOCK_HANDLE request_lock;
+    const char * active_request; //requestId of the command being executed, guarded by request_lock
+    tickcounter_ms_t deadline; //0 when the command being executed is unbounded
+    volatile int cancelled;
+    volatile int timed_out;
+    int scheduler; //commands are queued to the worker when lanes are configured, executed on receive otherwise
+    LOCK_HANDLE queue_lock;
+    COND_HANDLE queue_cond; //posted under queue_lock when a command is queued or the worker has to stop
+    SQLITE_LANE lanes[SQLITE_LANE_COUNT];
+    uint64_t virtual_clock;
+    THREAD_HANDLE worker;
+    volatile int stopping;
+    SQLITE_MEMORY_CONFIG memory;
+    SQLITE_HEAP_CONFIG heap;
+    SQLITE_ARENA arena;
+    SQLITE_STMT_CACHE_ENTRY stmt_cache[STMT_CACHE_SIZE]; //statements prepared on db, finalized before it closes
+    uint64_t stmt_clock;
+    SQLITE_SLOW_QUERY_CONFIG slow_query;
+    SQLITE_SLOW_QUERY * slow_ring; //the last ringSize sampled slow commands, NULL when not configured
+    size_t slow_next;
+    size_t slow_total; //slow commands seen since Sqlite_Create, sampled or not
+    int attach; //the other configured database files are attached to db under their source ids
+    SQLITE_MAINTENANCE_CONFIG maintenance;
+    SQLITE_BACKPRESSURE_CONFIG backpressure; //watermarks with the low ones filled in, all 0 when not configured
+    tickcounter_ms_t last_busy; //when the worker last ran a command
+    tickcounter_ms_t maintenance_due; //when the next maintenance pass starts
+    SQLITE_SOURCE * maintenance_file; //first source of the database file being maintained, NULL between passes
+    sqlite3 * maintenance_db; //open on maintenance_file, apart from db so the command connection and its statements stay as they are
+    SQLITE_SOURCE * maintenance_table; //next source of that file to analyze
+    SQLITE_MAINTENANCE_STEP maintenance_step;
+    int trace;
+    SQLITE_TRACE * current_trace; //of the command being executed, NULL when tracing is off
+    const SQLITE_REQUEST * current_request; //of the command being executed, its result is addressed from it
+    SQLITE_HISTOGRAM histograms[SQLITE_TRACE_STAGE_COUNT];
+    FILE * capture; //NULL when capture is off or failed
+    uint64_t capture_start;
 }SQLITE_HANDLE_DATA;
 
+typedef struct SQLITE_PAGE_TAG
+{
+    const char * column; //key column of the range request
+    int size;
+    char rowid[32]; //of the last row added to the result
+    char value[BUFSIZE]; //key column of the last row added to the result
+}SQLITE_PAGE;
+
 MESSAGE_CONFIG msgConfig;
 MAP_HANDLE propertiesMap;
 static int result_idx;
@@ -32,10 +233,17 @@ static char onlineText[35] = "{\"notice\":\"sqlite module online!\"}";
 static char resultKey[BUFSIZE];
 static char resultText[BUFSIZE];
 static char errorText[BUFSIZE];
+static char resultPrefix[BUFSIZE]; //"batch[<n>]." while a batch runs, empty otherwise
+static SQLITE_PAGE * currentPage; //set while a range request runs, NULL otherwise
 JSON_Value *error_root_value;
 JSON_Object *error_root_object;
 JSON_Value *result_root_value;
 JSON_Object *result_root_object;
+#ifdef SQLITE_MODULE_STATIC_HEAP
+static void * static_heap;
+static void * static_page_cache;
+static int sqlite_instances; //module instances in the process, they all share SQLite and its static heap
+#endif
 
 static bool isValidMac(char* mac)
 {
@@ -83,14 +291,36 @@ static SQLITE_SOURCE * find_source(const char * source, SQLITE_HANDLE_DATA * han
     }
     return find;
 }
+static SQLITE_SOURCE * find_source_by_path(const char * database, SQLITE_HANDLE_DATA * handleData)
+{
+    SQLITE_SOURCE * find = handleData->sources;
+    while (find)
+    {
+        if (find->dbPath != NULL && strcmp(database, find->dbPath) == 0)
+            break;
+        find = find->p_next;
+    }
+    return find;
+}
+static void add_result_column(const char * name, const char * value)
+{
+    LogInfo("%s = %s", name, value ? value : "NULL");
+    SNPRINTF_S(resultKey, BUFSIZE, "%sresult[%d].%s", resultPrefix, result_idx, name);
+    json_object_dotset_string(result_root_object, resultKey, value ? value : "NULL");
+    if (currentPage != NULL)
+    {
+        if (strcmp(name, "gw_rowid") == 0)
+            SNPRINTF_S(currentPage->rowid, sizeof(currentPage->rowid), "%s", value ? value : "");
+        else if (strcmp(name, currentPage->column) == 0)
+            SNPRINTF_S(currentPage->value, sizeof(currentPage->value), "%s", value ? value : "");
+    }
+}
 static int callback(void *NotUsed, int argc, char **argv, char **azColName) 
 {
     //publish result to iotHub
     int i;
     for (i = 0; i<argc; i++) {
-        LogInfo("%s = %s", azColName[i], argv[i] ? argv[i] : "NULL");
-        SNPRINTF_S(resultKey, BUFSIZE, "result[%d].%s", result_idx, azColName[i]);
-        json_object_dotset_string(result_root_object, resultKey, argv[i] ? argv[i] : "NULL");
+        add_result_column(azColName[i], argv[i]);
     }
     LogInfo("\n"); 
     result_idx++;
@@ -112,6 +342,22 @@ static void sqlite_source_cleanup(SQLITE_SOURCE * source)
             free(temp_column);
         }
 
+        SQLITE_INDEX * index = source->indexes;
+        while (index)
+        {
+            SQLITE_INDEX * temp_index = index;
+            index = index->p_next;
+            if (temp_index->name)
+                free((void*)temp_index->name);
+            if (temp_index->columns)
+                free((void*)temp_index->columns);
+            if (temp_index->include)
+                free((void*)temp_index->include);
+            if (temp_index->where)
+                free((void*)temp_index->where);
+            free(temp_index);
+        }
+
         SQLITE_SOURCE * temp_source = source;
         source = source->p_next;
 		if (temp_source->id)
@@ -120,6 +366,13 @@ static void sqlite_source_cleanup(SQLITE_SOURCE * source)
             free((void*)temp_source->dbPath);
 		if (temp_source->table)
             free((void*)temp_source->table);
+        if (temp_source->rateState)
+        {
+            free(temp_source->rateState->pending);
+            if (temp_source->rateState->pending_properties != NULL)
+                ConstMap_Destroy(temp_source->rateState->pending_properties);
+            free(temp_source->rateState);
+        }
         free(temp_source);
     }
 }
@@ -130,6 +383,8 @@ static bool addOneColumn(SQLITE_COLUMN * column, JSON_Object * column_obj)
     const char* type = json_object_get_string(column_obj, "type");
     const char* primaryKey = json_object_get_string(column_obj, "primaryKey");
     const char* notNull = json_object_get_string(column_obj, "notNull");
+    /*Codes_SRS_SQLITE_JSON_99_051: [ `Sqlite_ParseConfigurationFromJson` shall read the optional "fullText" value of each column, 0 when missing. ]*/
+    const char* fullText = json_object_get_string(column_obj, "fullText");
 
     if (name == NULL)
     {
@@ -166,6 +421,7 @@ static bool addOneColumn(SQLITE_COLUMN * column, JSON_Object * column_obj)
     mallocAndStrcpy_s((char **)&(column->type), type);
     column->primaryKey = atoi(primaryKey);
     column->notNull = atoi(primaryKey);
+    column->fullText = (fullText != NULL) ? atoi(fullText) : 0;
 
     return result;
 }
@@ -243,6 +499,120 @@ static bool addOneSource(SQLITE_SOURCE * source, JSON_Object * source_obj)
 
     return result;
 }
+static bool addOneIndex(SQLITE_INDEX * index, JSON_Object * index_obj)
+{
+    const char* name = json_object_get_string(index_obj, "name");
+    const char* columns = json_object_get_string(index_obj, "columns");
+    const char* include = json_object_get_string(index_obj, "include");
+    const char* where = json_object_get_string(index_obj, "where");
+    const char* unique = json_object_get_string(index_obj, "unique");
+
+    if (name == NULL)
+    {
+        /*Codes_SRS_SQLITE_JSON_99_053: [ If an `indexes` object does not contain a value named "name" or "columns" then Sqlite_ParseConfigurationFromJson shall fail and return NULL. ]*/
+        LogError("Did not find expected %s configuration", "name");
+        return false;
+    }
+    else if (columns == NULL)
+    {
+        LogError("Did not find expected %s configuration", "columns");
+        return false;
+    }
+
+    mallocAndStrcpy_s((char **)&(index->name), name);
+    mallocAndStrcpy_s((char **)&(index->columns), columns);
+    if (include != NULL)
+        mallocAndStrcpy_s((char **)&(index->include), include);
+    if (where != NULL)
+        mallocAndStrcpy_s((char **)&(index->where), where);
+    index->unique = (unique != NULL) ? atoi(unique) : 0;
+    return true;
+}
+static bool addAllIndexes(SQLITE_SOURCE * source, JSON_Array * index_array)
+{
+    bool ret = true;
+    int index_count = json_array_get_count(index_array);
+    int index_idx;
+    for (index_idx = 0; index_idx < index_count; index_idx++)
+    {
+        SQLITE_INDEX * index = malloc(sizeof(SQLITE_INDEX));
+        if (index == NULL)
+        {
+            ret = false;
+            break;
+        }
+        memset(index, 0, sizeof(SQLITE_INDEX));
+        index->p_next = source->indexes;
+        source->indexes = index;
+        if (!addOneIndex(index, json_array_get_object(index_array, index_idx)))
+        {
+            ret = false;
+            break;
+        }
+    }
+    return ret;
+}
+static const char * rate_policy_names[] = { "drop", "reject", "coalesce" };
+static const char * lane_names[SQLITE_LANE_COUNT] = { "ingest", "interactive", "bulk" };
+
+static bool addSourceOptions(SQLITE_SOURCE * source, JSON_Object * source_obj)
+{
+    const char* timeout = json_object_get_string(source_obj, "timeout");
+
+    /*Codes_SRS_SQLITE_JSON_99_047: [ If the `sources` object contains a value named "timeout", `Sqlite_ParseConfigurationFromJson` shall use it as the execution deadline in milliseconds for commands on this source. ]*/
+    source->timeout = (timeout != NULL) ? atoi(timeout) : 0;
+
+    /*Codes_SRS_SQLITE_JSON_99_052: [ If the `sources` object contains an "indexes" array, `Sqlite_ParseConfigurationFromJson` shall read "name", "columns", "include", "where" and "unique" of each index. ]*/
+    JSON_Array * index_array = json_object_get_array(source_obj, "indexes");
+    bool result = (index_array == NULL) || addAllIndexes(source, index_array);
+
+    /*Codes_SRS_SQLITE_JSON_99_055: [ If the `sources` object contains a "partition" object, `Sqlite_ParseConfigurationFromJson` shall read its "interval" ("hour", "day" or seconds) and "keep". ]*/
+    JSON_Object * partition_obj = result ? json_object_get_object(source_obj, "partition") : NULL;
+    if (partition_obj != NULL)
+    {
+        const char* interval = json_object_get_string(partition_obj, "interval");
+        const char* keep = json_object_get_string(partition_obj, "keep");
+        if (interval != NULL && strcmp(interval, "hour") == 0)
+            source->partitionInterval = 3600;
+        else if (interval != NULL && strcmp(interval, "day") == 0)
+            source->partitionInterval = 86400;
+        else
+            source->partitionInterval = (interval != NULL) ? atoi(interval) : 0;
+        source->partitionKeep = (keep != NULL) ? atoi(keep) : 0;
+        if (source->partitionInterval <= 0)
+        {
+            LogError("invalid partition interval for %s, the table is not partitioned", source->table);
+            source->partitionInterval = 0;
+        }
+        if (source->partitionKeep <= 0)
+            source->partitionKeep = DEFAULT_PARTITION_KEEP;
+    }
+
+    /*Codes_SRS_SQLITE_JSON_99_060: [ If the `sources` object contains a "rate" object, `Sqlite_ParseConfigurationFromJson` shall read its "commands", "bytes", "burst" and "policy" ("drop", "reject" or "coalesce"). ]*/
+    JSON_Object * rate_obj = result ? json_object_get_object(source_obj, "rate") : NULL;
+    if (rate_obj != NULL)
+    {
+        const char* commands = json_object_get_string(rate_obj, "commands");
+        const char* bytes = json_object_get_string(rate_obj, "bytes");
+        const char* burst = json_object_get_string(rate_obj, "burst");
+        const char* policy = json_object_get_string(rate_obj, "policy");
+        int policy_idx;
+        source->rateCommands = (commands != NULL && atoi(commands) > 0) ? atoi(commands) : 0;
+        source->rateBytes = (bytes != NULL && atoi(bytes) > 0) ? atoi(bytes) : 0;
+        source->rateBurst = (burst != NULL && atoi(burst) > 0) ? atoi(burst) : 0;
+        source->ratePolicy = SQLITE_RATE_DROP;
+        for (policy_idx = 0; policy != NULL && policy_idx < (int)(sizeof(rate_policy_names) / sizeof(rate_policy_names[0])); policy_idx++)
+        {
+            if (strcmp(policy, rate_policy_names[policy_idx]) == 0)
+                break;
+        }
+        if (policy != NULL && policy_idx == (int)(sizeof(rate_policy_names) / sizeof(rate_policy_names[0])))
+            LogError("unknown rate policy %s for %s, over the rate commands are dropped", policy, source->table);
+        else if (policy != NULL)
+            source->ratePolicy = (SQLITE_RATE_POLICY)policy_idx;
+    }
+    return result;
+}
 static bool addAllSources(SQLITE_CONFIG * config, JSON_Array * source_array)
 {
     bool ret = true;
@@ -275,6 +645,11 @@ static bool addAllSources(SQLITE_CONFIG * config, JSON_Array * source_array)
                     ret = false;
                     break;
                 }
+                if (!addSourceOptions(source, source_obj))
+                {
+                    ret = false;
+                    break;
+                }
             }
             else 
             {
@@ -286,186 +661,3754 @@ static bool addAllSources(SQLITE_CONFIG * config, JSON_Array * source_array)
     }
     return ret;
 }
-static void sqlite_publish(BROKER_HANDLE broker, SQLITE_HANDLE_DATA * handle)
+static void addOneLane(SQLITE_LANE_CONFIG * lane, JSON_Object * lanes_obj, const char * lane_name)
 {
-    MESSAGE_HANDLE sqliteMessage = Message_Create(&msgConfig);
-    if (sqliteMessage == NULL)
+    JSON_Object * lane_obj = json_object_get_object(lanes_obj, lane_name);
+    if (lane_obj != NULL)
     {
-        LogError("unable to create \"sqlite\" message");
+        const char* weight = json_object_get_string(lane_obj, "weight");
+        const char* latencyTarget = json_object_get_string(lane_obj, "latencyTarget");
+        const char* capacity = json_object_get_string(lane_obj, "capacity");
+        lane->weight = (weight != NULL) ? atoi(weight) : 1;
+        lane->latencyTarget = (latencyTarget != NULL) ? atoi(latencyTarget) : 0;
+        lane->capacity = (capacity != NULL) ? atoi(capacity) : 0;
+        if (lane->weight <= 0)
+        {
+            LogError("invalid weight for lane %s, using 1", lane_name);
+            lane->weight = 1;
+        }
+        if (lane->capacity < 0)
+        {
+            LogError("invalid capacity for lane %s, using %d", lane_name, DEFAULT_LANE_CAPACITY);
+            lane->capacity = 0;
+        }
     }
-    else
+}
+static void addMemoryOptions(SQLITE_MEMORY_CONFIG * memory, JSON_Object * memory_obj)
+{
+    const char* softHeapLimit = json_object_get_string(memory_obj, "softHeapLimit");
+    const char* hardHeapLimit = json_object_get_string(memory_obj, "hardHeapLimit");
+    const char* cacheSize = json_object_get_string(memory_obj, "cacheSize");
+    const char* releaseThreshold = json_object_get_string(memory_obj, "releaseThreshold");
+    memory->softHeapLimit = (softHeapLimit != NULL) ? atoll(softHeapLimit) : 0;
+    memory->hardHeapLimit = (hardHeapLimit != NULL) ? atoll(hardHeapLimit) : 0;
+    memory->cacheSize = (cacheSize != NULL) ? atoi(cacheSize) : 0;
+    memory->releaseThreshold = (releaseThreshold != NULL) ? atoi(releaseThreshold) : 0;
+    if (memory->releaseThreshold < 0 || memory->releaseThreshold > 100)
     {
-        (void)Broker_Publish(broker, handle, sqliteMessage);
-        Message_Destroy(sqliteMessage);
+        LogError("invalid releaseThreshold %d, using %d", memory->releaseThreshold, DEFAULT_RELEASE_THRESHOLD);
+        memory->releaseThreshold = 0;
     }
 }
-static void sqlite_exec(SQLITE_HANDLE_DATA* handle, char* sql, int publish)
+static void addHeapOptions(SQLITE_HEAP_CONFIG * heap, JSON_Object * heap_obj)
 {
-    char *zErrMsg = 0;
-    int rc;
-    error_root_value = json_value_init_object();
-    error_root_object = json_value_get_object(error_root_value);
-    result_root_value = json_value_init_object();
-    result_root_object = json_value_get_object(result_root_value);
-    char *serialized_string = NULL;
-
-    /* Execute SQL statement */
-    if (handle != NULL && sql != NULL)
+    const char* size = json_object_get_string(heap_obj, "size");
+    const char* minAllocation = json_object_get_string(heap_obj, "minAllocation");
+    const char* pageCacheSlot = json_object_get_string(heap_obj, "pageCacheSlot");
+    const char* pageCacheCount = json_object_get_string(heap_obj, "pageCacheCount");
+    const char* arenaSize = json_object_get_string(heap_obj, "arenaSize");
+    heap->size = (size != NULL) ? atoi(size) : 0;
+    heap->minAllocation = (minAllocation != NULL) ? atoi(minAllocation) : 0;
+    heap->pageCacheSlot = (pageCacheSlot != NULL) ? atoi(pageCacheSlot) : 0;
+    heap->pageCacheCount = (pageCacheCount != NULL) ? atoi(pageCacheCount) : 0;
+    heap->arenaSize = (arenaSize != NULL) ? atoi(arenaSize) : 0;
+}
+static void addSlowQueryOptions(SQLITE_SLOW_QUERY_CONFIG * slow_query, JSON_Object * slow_obj)
+{
+    const char* threshold = json_object_get_string(slow_obj, "threshold");
+    const char* ringSize = json_object_get_string(slow_obj, "ringSize");
+    const char* sampleRate = json_object_get_string(slow_obj, "sampleRate");
+    slow_query->threshold = (threshold != NULL) ? atoi(threshold) : 0;
+    slow_query->ringSize = (ringSize != NULL) ? atoi(ringSize) : 0;
+    slow_query->sampleRate = (sampleRate != NULL) ? atoi(sampleRate) : 0;
+}
+static void addMaintenanceOptions(SQLITE_MAINTENANCE_CONFIG * maintenance, JSON_Object * maintenance_obj)
+{
+    const char* interval = json_object_get_string(maintenance_obj, "interval");
+    const char* idleTime = json_object_get_string(maintenance_obj, "idleTime");
+    const char* sliceBudget = json_object_get_string(maintenance_obj, "sliceBudget");
+    const char* vacuumPages = json_object_get_string(maintenance_obj, "vacuumPages");
+    const char* analysisLimit = json_object_get_string(maintenance_obj, "analysisLimit");
+    const char* rebuild = json_object_get_string(maintenance_obj, "rebuild");
+    maintenance->interval = (interval != NULL) ? atoi(interval) : DEFAULT_MAINTENANCE_INTERVAL;
+    maintenance->idleTime = (idleTime != NULL) ? atoi(idleTime) : 0;
+    maintenance->sliceBudget = (sliceBudget != NULL) ? atoi(sliceBudget) : 0;
+    maintenance->vacuumPages = (vacuumPages != NULL) ? atoi(vacuumPages) : 0;
+    maintenance->analysisLimit = (analysisLimit != NULL) ? atoi(analysisLimit) : 0;
+    maintenance->rebuild = (rebuild != NULL) ? atoi(rebuild) : 0;
+    if (maintenance->interval <= 0)
     {
-        result_idx = 0;
-        
-        rc = sqlite3_exec(handle->db, sql, callback, 0, &zErrMsg);
-        if (rc != SQLITE_OK) 
-        {
-            LogError("SQL error: %s", zErrMsg);    
-            json_object_set_string(error_root_object, "error", zErrMsg);
-
-            serialized_string = json_serialize_to_string_pretty(error_root_value);
-            msgConfig.source = (const unsigned char *)serialized_string;
-            msgConfig.size = strlen(serialized_string);
-            if (publish == 1)
-            {
-                sqlite_publish(handle->broker, handle);
-            }
-
-            sqlite3_free(zErrMsg);    
-        }
-        else 
-        {
-            LogInfo("operation done successfully");
-
-            serialized_string = json_serialize_to_string_pretty(result_root_value);
-            msgConfig.source = (const unsigned char *)serialized_string;
-            msgConfig.size = strlen(serialized_string);
-            if (publish == 1)
-            {
-                sqlite_publish(handle->broker, handle);
-            }
-        }
-        json_free_serialized_string(serialized_string);
+        LogError("invalid maintenance interval, maintenance is disabled");
+        maintenance->interval = 0;
     }
-    json_value_free(error_root_value);
-    json_value_free(result_root_value);
 }
-//select * from sqlite_master where type = 'trigger'; list all triggers
-static void sqlite_try_update_trigger(SQLITE_HANDLE_DATA * handleData, SQLITE_SOURCE * src_table)
+/*worker is whether the rest of the configuration starts the command worker, highLatency starts it as well*/
+static void addBackpressureOptions(SQLITE_BACKPRESSURE_CONFIG * backpressure, JSON_Object * backpressure_obj, bool worker)
 {
-    char sql_trigger[BUFSIZE] = { 0 };
-    char sql_drop_trigger[BUFSIZE] = { 0 };
-    char sql_primary[BUFSIZE] = { 0 };
-    int index;
-
-    SQLITE_COLUMN *column = src_table->columns;
-    while (column)
+    const char* highBacklog = json_object_get_string(backpressure_obj, "highBacklog");
+    const char* lowBacklog = json_object_get_string(backpressure_obj, "lowBacklog");
+    const char* highLatency = json_object_get_string(backpressure_obj, "highLatency");
+    const char* lowLatency = json_object_get_string(backpressure_obj, "lowLatency");
+    backpressure->highBacklog = (highBacklog != NULL && atoi(highBacklog) > 0) ? atoi(highBacklog) : 0;
+    backpressure->lowBacklog = (lowBacklog != NULL && atoi(lowBacklog) > 0) ? atoi(lowBacklog) : 0;
+    backpressure->highLatency = (highLatency != NULL && atoi(highLatency) > 0) ? atoi(highLatency) : 0;
+    backpressure->lowLatency = (lowLatency != NULL && atoi(lowLatency) > 0) ? atoi(lowLatency) : 0;
+    if (backpressure->highBacklog > 0 && !worker && backpressure->highLatency == 0)
     {
-        if (column->primaryKey == 1)
-        {
-            index = strlen(sql_primary);
-            SNPRINTF_S(sql_primary + index, BUFSIZE - index, "%s,", column->name);
-        }
-        column = column->p_next;
+        /*only the worker queues commands, without it the backlog of a source stays 0*/
+        LogError("highBacklog needs the command worker, it is ignored");
+        backpressure->highBacklog = 0;
+        backpressure->lowBacklog = 0;
+    }
+    if (backpressure->highBacklog == 0 && backpressure->highLatency == 0)
+    {
+        LogError("backpressure has no high watermark, no advisories are published");
     }
-    sql_primary[strlen(sql_primary)-1] = '\0'; // remove last comma
-
-	SNPRINTF_S(sql_drop_trigger, BUFSIZE, "DROP TRIGGER %s_size_control;", src_table->table);
-	SNPRINTF_S(sql_trigger, BUFSIZE, "CREATE TRIGGER %s_size_control INSERT ON %s WHEN (SELECT count(*) from %s)>%d\n"
-		"BEGIN\n"
-		"DELETE FROM %s WHERE rowid <= (SELECT max(rowid) - %d FROM %s);\n"
-		"END;",
-        src_table->table, src_table->table, src_table->table, src_table->limit,
-        src_table->table, src_table->limit, src_table->table
-        );
-    sqlite_exec(handleData, sql_drop_trigger, 0);
-    sqlite_exec(handleData, sql_trigger, 0);
 }
-//PRAGMA table_info('TABLENAME'); list all columns of 'TABLENAME'
-static void sqlite_try_create_table(SQLITE_HANDLE_DATA * handleData, SQLITE_SOURCE * src_table)
+static void addModuleOptions(SQLITE_CONFIG * config, JSON_Object * obj)
 {
-    char sql_create[BUFSIZE] = { 0 };
-    char sql_primary[BUFSIZE] = { 0 };
-    int index = 0;
-    SQLITE_COLUMN *column = src_table->columns;
-
-    SNPRINTF_S(sql_create + index, BUFSIZE - index, "create table if not exists %s (", src_table->table);
-    SNPRINTF_S(sql_primary + index, BUFSIZE - index, "PRIMARY KEY (");
-    while (column)
+    /*Codes_SRS_SQLITE_JSON_99_048: [ If the configuration contains a "lanes" object, `Sqlite_ParseConfigurationFromJson` shall read "weight", "latencyTarget" and "capacity" of the "ingest", "interactive" and "bulk" lanes and commands shall be executed by the lane scheduler. ]*/
+    JSON_Object * lanes_obj = json_object_get_object(obj, "lanes");
+    if (lanes_obj != NULL)
     {
-        //construct primary key
-        if (column->primaryKey == 1)
+        int lane_id;
+        addOneLane(&(config->lanes[SQLITE_LANE_INGEST]), lanes_obj, "ingest");
+        addOneLane(&(config->lanes[SQLITE_LANE_INTERACTIVE]), lanes_obj, "interactive");
+        addOneLane(&(config->lanes[SQLITE_LANE_BULK]), lanes_obj, "bulk");
+        for (lane_id = 0; lane_id < SQLITE_LANE_COUNT; lane_id++)
         {
-            index = strlen(sql_primary);
-            SNPRINTF_S(sql_primary + index, BUFSIZE - index, "%s,", column->name);
+            if (config->lanes[lane_id].weight == 0)
+                config->lanes[lane_id].weight = 1;
         }
+    }
 
-        //construct create table
-        index = strlen(sql_create);
-        SNPRINTF_S(sql_create + index, BUFSIZE - index, "%s %s %s,",
-            column->name,
-            column->type,
-            (column->notNull == 1) ? "NOT NULL" : ""
-        );
-        column = column->p_next;
+    /*Codes_SRS_SQLITE_JSON_99_049: [ If the configuration contains a "memory" object, `Sqlite_ParseConfigurationFromJson` shall read "softHeapLimit", "hardHeapLimit", "cacheSize" and "releaseThreshold" from it. ]*/
+    JSON_Object * memory_obj = json_object_get_object(obj, "memory");
+    if (memory_obj != NULL)
+    {
+        addMemoryOptions(&(config->memory), memory_obj);
     }
-    index = strlen(sql_primary);
-    SNPRINTF_S(sql_primary + index - 1, BUFSIZE - index + 1, ")");
 
-    index = strlen(sql_create);
-    SNPRINTF_S(sql_create + index, BUFSIZE - index, "%s);", sql_primary);
+    /*Codes_SRS_SQLITE_JSON_99_050: [ If the configuration contains a "heap" object, `Sqlite_ParseConfigurationFromJson` shall read "size", "minAllocation", "pageCacheSlot", "pageCacheCount" and "arenaSize" from it. ]*/
+    JSON_Object * heap_obj = json_object_get_object(obj, "heap");
+    if (heap_obj != NULL)
+    {
+        addHeapOptions(&(config->heap), heap_obj);
+    }
 
-    sqlite_exec(handleData, sql_create, 0);
-}
-static bool sqlite_try_open_db(const char * database, SQLITE_HANDLE_DATA * handleData)
-{
-    const char * current_db;
-    int rc;
-    bool ret = false;
-    if (handleData->db != NULL)
+    /*Codes_SRS_SQLITE_JSON_99_054: [ If the configuration contains a "slowQuery" object, `Sqlite_ParseConfigurationFromJson` shall read "threshold", "ringSize" and "sampleRate" from it. ]*/
+    JSON_Object * slow_obj = json_object_get_object(obj, "slowQuery");
+    if (slow_obj != NULL)
     {
-        current_db = sqlite3_db_filename(handleData->db, "main");
-        if (strcmp(current_db, database) != 0)
-        {
-            sqlite3_close(handleData->db);
-            handleData->db = NULL;
-        }
-        else
-            ret = true;
+        addSlowQueryOptions(&(config->slowQuery), slow_obj);
     }
-    if (handleData->db == NULL)
+
+    /*Codes_SRS_SQLITE_JSON_99_056: [ `Sqlite_ParseConfigurationFromJson` shall read the optional "attach" value of the configuration, 0 when missing. ]*/
+    const char * attach = json_object_get_string(obj, "attach");
+    config->attach = (attach != NULL) ? atoi(attach) : 0;
+
+    /*Codes_SRS_SQLITE_JSON_99_057: [ If the configuration contains a "maintenance" object, `Sqlite_ParseConfigurationFromJson` shall read "interval", "idleTime", "sliceBudget", "vacuumPages", "analysisLimit" and "rebuild" from it. ]*/
+    JSON_Object * maintenance_obj = json_object_get_object(obj, "maintenance");
+    if (maintenance_obj != NULL)
     {
-        rc = sqlite3_open(database, &(handleData->db));
-        if (rc != 0)
-        {
-            LogError("Can't open database: %s", sqlite3_errmsg(handleData->db));
-        }
-        else
+        addMaintenanceOptions(&(config->maintenance), maintenance_obj);
+    }
+
+    /*Codes_SRS_SQLITE_JSON_99_058: [ `Sqlite_ParseConfigurationFromJson` shall read the optional "trace" value of the configuration, 0 when missing. ]*/
+    const char * trace = json_object_get_string(obj, "trace");
+    config->trace = (trace != NULL) ? atoi(trace) : 0;
+
+    /*Codes_SRS_SQLITE_JSON_99_059: [ `Sqlite_ParseConfigurationFromJson` shall copy the optional "capture" path of the configuration, NULL when missing. ]*/
+    const char * capture = json_object_get_string(obj, "capture");
+    if (capture != NULL && mallocAndStrcpy_s((char **)&(config->capture), capture) != 0)
+    {
+        LogError("unable to copy the capture path, messages will not be captured");
+        config->capture = NULL;
+    }
+
+    /*Codes_SRS_SQLITE_JSON_99_061: [ If the configuration contains a "backpressure" object, `Sqlite_ParseConfigurationFromJson` shall read "highBacklog", "lowBacklog", "highLatency" and "lowLatency" from it. ]*/
+    /*Codes_SRS_SQLITE_JSON_99_062: [ `Sqlite_ParseConfigurationFromJson` shall ignore "highBacklog" and "lowBacklog" unless "lanes", "maintenance", a coalescing source rate or "highLatency" start the command worker. ]*/
+    JSON_Object * backpressure_obj = json_object_get_object(obj, "backpressure");
+    if (backpressure_obj != NULL)
+    {
+        /*the conditions sqlite_init_lanes starts the worker on, the sources are parsed by now*/
+        bool worker = (lanes_obj != NULL || config->maintenance.interval > 0);
+        const SQLITE_SOURCE * source;
+        for (source = config->sources; source != NULL; source = source->p_next)
         {
-            LogInfo("Opened database %s successfully", database);
-            ret = true;
+            if (source->ratePolicy == SQLITE_RATE_COALESCE && (source->rateCommands > 0 || source->rateBytes > 0))
+                worker = true;
         }
+        addBackpressureOptions(&(config->backpressure), backpressure_obj, worker);
     }
-    return ret;
 }
-static MODULE_HANDLE Sqlite_Create(BROKER_HANDLE broker, const void* configuration)
+static const char * trace_stage_names[SQLITE_TRACE_STAGE_COUNT] = { "queue", "dispatch", "exec", "serialize", "publish", "total" };
+static const char * trace_property_names[SQLITE_TRACE_STAGE_COUNT] = { "traceQueueUs", "traceDispatchUs", "traceExecUs", "traceSerializeUs", NULL, "traceTotalUs" };
+/*monotonic microseconds, the tick counter only has milliseconds*/
+static uint64_t sqlite_trace_now(void)
 {
-    bool isValidConfig = true;
-    SQLITE_HANDLE_DATA* result = NULL;
-    char *zErrMsg = 0;
-    SQLITE_CONFIG* config = (SQLITE_CONFIG*)configuration;
-    if ((broker == NULL) || (config == NULL))
+#ifdef _MSC_VER
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    (void)QueryPerformanceFrequency(&frequency);
+    (void)QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+#endif
+}
+static void sqlite_trace_stamp(SQLITE_HANDLE_DATA * handle, SQLITE_TRACE_POINT point)
+{
+    if (handle->current_trace != NULL)
     {
-
-        /*Codes_SRS_SQLITE_99_001: [If broker is NULL then Sqlite_Create shall fail and return NULL.]*/
-        /*Codes_SRS_SQLITE_99_002 : [If configuration is NULL then Sqlite_Create shall fail and return NULL.]*/
-        LogError("invalid arg broker=%p configuration=%p", broker, config);
+        handle->current_trace->stamps[point] = sqlite_trace_now();
+    }
+}
+/*duration of a stage, -1 when the command did not go through it*/
+static long long sqlite_trace_stage(const SQLITE_TRACE * trace, SQLITE_TRACE_STAGE stage)
+{
+    static const SQLITE_TRACE_POINT from[SQLITE_TRACE_STAGE_COUNT] = { SQLITE_TRACE_RECEIVED, SQLITE_TRACE_DEQUEUED, SQLITE_TRACE_EXEC_START, SQLITE_TRACE_EXEC_END, SQLITE_TRACE_SERIALIZED, SQLITE_TRACE_RECEIVED };
+    static const SQLITE_TRACE_POINT to[SQLITE_TRACE_STAGE_COUNT] = { SQLITE_TRACE_DEQUEUED, SQLITE_TRACE_EXEC_START, SQLITE_TRACE_EXEC_END, SQLITE_TRACE_SERIALIZED, SQLITE_TRACE_PUBLISHED, SQLITE_TRACE_PUBLISHED };
+    uint64_t end = trace->stamps[to[stage]];
+    int point;
+    if (stage == SQLITE_TRACE_TOTAL)
+    {
+        /*a command without a published result ends at its last stamp*/
+        for (point = SQLITE_TRACE_PUBLISHED; end == 0 && point > SQLITE_TRACE_RECEIVED; point--)
+            end = trace->stamps[point];
+    }
+    if (trace->stamps[from[stage]] == 0 || end == 0 || end < trace->stamps[from[stage]])
+        return -1;
+    return (long long)(end - trace->stamps[from[stage]]);
+}
+static void sqlite_capture_open(SQLITE_HANDLE_DATA * handle, const char * path)
+{
+    /*appended, so a restart adds a session to the log instead of replacing it*/
+    handle->capture = fopen(path, "ab");
+    if (handle->capture == NULL)
+    {
+        LogError("unable to open capture log %s, messages will not be captured", path);
+    }
+    else if (fwrite(SQLITE_CAPTURE_MAGIC, 1, SQLITE_CAPTURE_MAGIC_SIZE, handle->capture) != SQLITE_CAPTURE_MAGIC_SIZE)
+    {
+        LogError("unable to write capture log %s, messages will not be captured", path);
+        (void)fclose(handle->capture);
+        handle->capture = NULL;
     }
     else
     {
-        // get library path from config
-        result = malloc(sizeof(SQLITE_HANDLE_DATA));
-        if (result != NULL)
-        {
-            char * mac;
-            int copy_result = mallocAndStrcpy_s(&mac, config->mac_address);
+        handle->capture_start = sqlite_trace_now();
+    }
+}
+static int sqlite_capture_bytes(FILE * file, uint64_t value, size_t size)
+{
+    unsigned char bytes[8];
+    size_t i;
+    for (i = 0; i < size; i++)
+    {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    return (fwrite(bytes, 1, size, file) == size) ? 0 : -1;
+}
+static int sqlite_capture_string(FILE * file, const char * text)
+{
+    size_t length = (text != NULL) ? strlen(text) : 0;
+    if (sqlite_capture_bytes(file, length, 4) != 0 || (length > 0 && fwrite(text, 1, length, file) != length))
+        return -1;
+    return 0;
+}
+/*properties that carry credentials, compared without case, the capture log is meant to be copied off the gateway*/
+static const char * const capture_secrets[] = { "deviceKey", "connectionString", "sharedAccessKey", "sharedAccessSignature", "password", "token" };
+static bool sqlite_capture_is_secret(const char * key)
+{
+    size_t i;
+    for (i = 0; key != NULL && i < sizeof(capture_secrets) / sizeof(capture_secrets[0]); i++)
+    {
+        const char * a = key;
+        const char * b = capture_secrets[i];
+        while (*a != '\0' && tolower((unsigned char)*a) == tolower((unsigned char)*b))
+        {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0')
+            return true;
+    }
+    return false;
+}
+/*Codes_SRS_SQLITE_99_036: [ If "capture" is configured, `Sqlite_Receive` shall append the time, the properties other than credentials and the content of every message it accepts to the capture log. ]*/
+static void sqlite_capture(SQLITE_HANDLE_DATA * handle, const CONSTBUFFER * content, CONSTMAP_HANDLE properties)
+{
+    const char * const * keys = NULL;
+    const char * const * values = NULL;
+    size_t count = 0;
+    size_t kept = 0;
+    size_t i;
+    int result;
+
+    if (ConstMap_GetInternals(properties, &keys, &values, &count) != CONSTMAP_OK)
+    {
+        LogError("unable to read message properties, message not captured");
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!sqlite_capture_is_secret(keys[i]))
+            kept++;
+    }
+    result = sqlite_capture_bytes(handle->capture, sqlite_trace_now() - handle->capture_start, 8);
+    if (result == 0)
+        result = sqlite_capture_bytes(handle->capture, kept, 4);
+    if (result == 0)
+        result = sqlite_capture_bytes(handle->capture, (content != NULL) ? content->size : 0, 4);
+    for (i = 0; result == 0 && i < count; i++)
+    {
+        if (sqlite_capture_is_secret(keys[i]))
+            continue;
+        result = sqlite_capture_string(handle->capture, keys[i]);
+        if (result == 0)
+            result = sqlite_capture_string(handle->capture, values[i]);
+    }
+    if (result == 0 && content != NULL && content->size > 0 && fwrite(content->buffer, 1, content->size, handle->capture) != content->size)
+        result = -1;
+    /*the log is most wanted after a crash, so it is not left in the buffer*/
+    if (result != 0 || fflush(handle->capture) != 0)
+    {
+        LogError("unable to write capture log, capture stopped");
+        (void)fclose(handle->capture);
+        handle->capture = NULL;
+    }
+}
+static MAP_HANDLE sqlite_message_properties(SQLITE_HANDLE_DATA * handle)
+{
+    /*the shared map goes out with every message, what belongs to this command goes on a copy*/
+    const SQLITE_REQUEST * request = handle->current_request;
+    MAP_HANDLE properties = Map_Clone(propertiesMap);
+    if (properties == NULL)
+    {
+        LogError("unable to clone message properties for the result");
+    }
+    else
+    {
+        /*Codes_SRS_SQLITE_99_037: [ The result of a command shall carry its "requestId" and, if the command has a "replyTo", a "target" property set to it, so receivers can discard results meant for other modules without parsing them. ]*/
+        if (request != NULL && request->request_id != NULL && Map_AddOrUpdate(properties, "requestId", request->request_id) != MAP_OK)
+        {
+            LogError("unable to add requestId to message properties");
+        }
+        if (request != NULL && request->reply_to != NULL && Map_AddOrUpdate(properties, "target", request->reply_to) != MAP_OK)
+        {
+            LogError("unable to add target to message properties");
+        }
+        /*the identity map forwards anything with a "macAddress" to IoT Hub, a local answer has to stay on the broker*/
+        if (request != NULL && request->local && Map_Delete(properties, "macAddress") != MAP_OK)
+        {
+            LogError("unable to remove macAddress from message properties");
+        }
+    }
+    /*Codes_SRS_SQLITE_99_034: [ If "trace" is configured, the result of a command shall carry the microseconds it spent queued, dispatched, executing and serializing as message properties. ]*/
+    if (properties != NULL && handle->current_trace != NULL)
+    {
+        char value[32];
+        long long duration;
+        int stage;
+        for (stage = 0; stage < SQLITE_TRACE_STAGE_COUNT; stage++)
+        {
+            duration = (trace_property_names[stage] != NULL) ? sqlite_trace_stage(handle->current_trace, (SQLITE_TRACE_STAGE)stage) : -1;
+            if (duration >= 0)
+            {
+                SNPRINTF_S(value, sizeof(value), "%lld", duration);
+                if (Map_AddOrUpdate(properties, trace_property_names[stage], value) != MAP_OK)
+                {
+                    LogError("unable to add %s to message properties", trace_property_names[stage]);
+                }
+            }
+        }
+    }
+    return properties;
+}
+static void * arena_malloc(SQLITE_ARENA * arena, size_t size)
+{
+    void * result;
+    size_t aligned = (size + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1);
+    if (arena->active && aligned <= arena->size - arena->used)
+    {
+        result = arena->buffer + arena->used;
+        arena->used += aligned;
+        if (arena->used > arena->highwater)
+            arena->highwater = arena->used;
+    }
+    else
+    {
+        arena->fallbacks++;
+        result = malloc(size);
+    }
+    return result;
+}
+static void arena_free(SQLITE_ARENA * arena, void * ptr)
+{
+    /*arena memory is only given back when the message is done*/
+    if ((unsigned char *)ptr < arena->buffer || (unsigned char *)ptr >= arena->buffer + arena->size)
+    {
+        free(ptr);
+    }
+}
+/*only the thread executing commands enters the arena, the receiving thread keeps to the system allocator*/
+static void sqlite_arena_enter(SQLITE_ARENA * arena)
+{
+    if (arena->buffer != NULL)
+    {
+        arena->used = 0;
+        arena->active = 1;
+    }
+}
+static void sqlite_arena_leave(SQLITE_ARENA * arena)
+{
+    if (arena->buffer != NULL)
+    {
+        arena->active = 0;
+        arena->used = 0;
+    }
+}
+/*Codes_SRS_SQLITE_99_044: [ While a command executes, its result shall be serialized into the message arena with `json_serialize_to_buffer_pretty`. ]*/
+/*parson's allocator is process wide and is left alone, only what the module serializes itself goes to the arena*/
+static char * sqlite_serialize(SQLITE_HANDLE_DATA * handle, const JSON_Value * value)
+{
+    char * result;
+    if (!handle->arena.active)
+    {
+        result = json_serialize_to_string_pretty(value);
+    }
+    else
+    {
+        size_t size = json_serialization_size_pretty(value);
+        result = (size > 0) ? (char *)arena_malloc(&(handle->arena), size) : NULL;
+        if (result != NULL && json_serialize_to_buffer_pretty(value, result, size) != JSONSuccess)
+        {
+            arena_free(&(handle->arena), result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+static void sqlite_serialized_free(SQLITE_HANDLE_DATA * handle, char * serialized_string)
+{
+    if (serialized_string == NULL)
+    {
+        /*nothing to give back*/
+    }
+    else if (!handle->arena.active)
+    {
+        /*the same check as sqlite_serialize, the thread executing commands is the only one to change it*/
+        json_free_serialized_string(serialized_string);
+    }
+    else
+    {
+        arena_free(&(handle->arena), serialized_string);
+    }
+}
+static void sqlite_publish(BROKER_HANDLE broker, SQLITE_HANDLE_DATA * handle)
+{
+    MESSAGE_HANDLE sqliteMessage;
+    MAP_HANDLE shared_properties = msgConfig.sourceProperties;
+    MAP_HANDLE message_properties = NULL;
+    const SQLITE_REQUEST * request = handle->current_request;
+
+    sqlite_trace_stamp(handle, SQLITE_TRACE_SERIALIZED);
+    if (handle->current_trace != NULL || (request != NULL && (request->request_id != NULL || request->reply_to != NULL || request->local)))
+    {
+        message_properties = sqlite_message_properties(handle);
+        if (message_properties != NULL)
+            msgConfig.sourceProperties = message_properties;
+    }
+    sqliteMessage = Message_Create(&msgConfig);
+    if (sqliteMessage == NULL)
+    {
+        LogError("unable to create \"sqlite\" message");
+    }
+    else
+    {
+        (void)Broker_Publish(broker, handle, sqliteMessage);
+        Message_Destroy(sqliteMessage);
+    }
+    if (message_properties != NULL)
+    {
+        msgConfig.sourceProperties = shared_properties;
+        Map_Destroy(message_properties);
+    }
+    sqlite_trace_stamp(handle, SQLITE_TRACE_PUBLISHED);
+}
+static void sqlite_publish_json(SQLITE_HANDLE_DATA * handle, JSON_Value * value)
+{
+    char * serialized_string = sqlite_serialize(handle, value);
+    if (serialized_string == NULL)
+    {
+        LogError("unable to serialize result");
+    }
+    else
+    {
+        msgConfig.source = (const unsigned char *)serialized_string;
+        msgConfig.size = strlen(serialized_string);
+        sqlite_publish(handle->broker, handle);
+        sqlite_serialized_free(handle, serialized_string);
+    }
+}
+/*publishes outside of msgConfig, so the receiving thread can use it while the worker publishes results;
+  with local set the message goes to the modules linked to this one, without the "macAddress" that routes to IoT Hub*/
+static void sqlite_publish_direct(SQLITE_HANDLE_DATA * handle, JSON_Value * value, const char * const * extra_properties, int local)
+{
+    char * serialized_string = json_serialize_to_string_pretty(value);
+    MAP_HANDLE local_properties = NULL;
+    if (serialized_string == NULL)
+    {
+        LogError("unable to serialize message");
+    }
+    else if ((local_properties = Map_Clone(propertiesMap)) == NULL)
+    {
+        LogError("unable to clone message properties");
+    }
+    else
+    {
+        MESSAGE_CONFIG localConfig;
+        MESSAGE_HANDLE localMessage;
+        size_t i;
+        if (local)
+        {
+            (void)Map_Delete(local_properties, "macAddress");
+        }
+        /*key and value pairs, a NULL value is skipped*/
+        for (i = 0; extra_properties != NULL && extra_properties[i] != NULL; i += 2)
+        {
+            if (extra_properties[i + 1] != NULL && Map_AddOrUpdate(local_properties, extra_properties[i], extra_properties[i + 1]) != MAP_OK)
+            {
+                LogError("unable to add %s to message properties", extra_properties[i]);
+            }
+        }
+        localConfig.size = strlen(serialized_string);
+        localConfig.source = (const unsigned char *)serialized_string;
+        localConfig.sourceProperties = local_properties;
+        if ((localMessage = Message_Create(&localConfig)) == NULL)
+        {
+            LogError("unable to create \"sqlite\" message");
+        }
+        else
+        {
+            (void)Broker_Publish(handle->broker, (MODULE_HANDLE)handle, localMessage);
+            Message_Destroy(localMessage);
+        }
+        Map_Destroy(local_properties);
+    }
+    if (serialized_string != NULL)
+    {
+        json_free_serialized_string(serialized_string);
+    }
+}
+/*Codes_SRS_SQLITE_99_041: [ If "backpressure" is configured, the module shall publish a "throttle" advisory naming a source when its queued commands or their average execution time reach a high watermark, and a "resume" advisory once both are back at or below the low watermarks. ]*/
+static void sqlite_check_backpressure(SQLITE_HANDLE_DATA * handle, SQLITE_SOURCE * source, double elapsed)
+{
+    const SQLITE_BACKPRESSURE_CONFIG * backpressure = &(handle->backpressure);
+    const char * advisory = NULL;
+    size_t backlog = 0;
+    double latency = 0;
+    /*the receiving thread and the worker both get here when commands are queued*/
+    if (!handle->scheduler || Lock(handle->queue_lock) == LOCK_OK)
+    {
+        bool over;
+        bool under;
+        if (elapsed >= 0)
+        {
+            /*moving average over about the last 8 commands*/
+            source->commitLatency += (elapsed - source->commitLatency) / 8;
+        }
+        backlog = source->queued;
+        latency = source->commitLatency;
+        over = (backpressure->highBacklog > 0 && backlog >= (size_t)backpressure->highBacklog) ||
+            (backpressure->highLatency > 0 && latency >= backpressure->highLatency);
+        under = (backpressure->highBacklog == 0 || backlog <= (size_t)backpressure->lowBacklog) &&
+            (backpressure->highLatency == 0 || latency <= backpressure->lowLatency);
+        if (!source->throttled && over)
+        {
+            source->throttled = 1;
+            advisory = "throttle";
+        }
+        else if (source->throttled && under)
+        {
+            source->throttled = 0;
+            advisory = "resume";
+        }
+        if (handle->scheduler)
+        {
+            (void)Unlock(handle->queue_lock);
+        }
+    }
+    if (advisory != NULL)
+    {
+        JSON_Value * advisory_value = json_value_init_object();
+        JSON_Object * advisory_object = json_value_get_object(advisory_value);
+        if (advisory_object == NULL)
+        {
+            LogError("unable to create %s advisory", advisory);
+        }
+        else
+        {
+            const char * extra_properties[5];
+            extra_properties[0] = "advisory";
+            extra_properties[1] = advisory;
+            extra_properties[2] = "sourceId";
+            extra_properties[3] = source->id;
+            extra_properties[4] = NULL;
+            json_object_set_string(advisory_object, "advisory", advisory);
+            json_object_set_string(advisory_object, "source", source->id);
+            json_object_set_number(advisory_object, "backlog", (double)backlog);
+            json_object_set_number(advisory_object, "latencyMs", latency);
+            LogInfo("%s advisory for source %s, %lu queued, %.1f ms per command", advisory, source->id, (unsigned long)backlog, latency);
+            sqlite_publish_direct(handle, advisory_value, extra_properties, 1);
+        }
+        json_value_free(advisory_value);
+    }
+}
+/*Codes_SRS_SQLITE_99_046: [ The idle worker shall count an empty queue as a command that took no time for every throttled source, so a source that went quiet is sent "resume". ]*/
+static void sqlite_recheck_backpressure(SQLITE_HANDLE_DATA * handle)
+{
+    SQLITE_SOURCE * source;
+    for (source = handle->sources; source != NULL; source = source->p_next)
+    {
+        /*read without the lock, sqlite_check_backpressure decides under it*/
+        if (source->throttled)
+        {
+            sqlite_check_backpressure(handle, source, 0);
+        }
+    }
+}
+static void sqlite_apply_memory_limits(const SQLITE_MEMORY_CONFIG * memory)
+{
+    /*heap limits are process wide, the last module instance to start wins*/
+    if (memory->softHeapLimit > 0)
+    {
+        (void)sqlite3_soft_heap_limit64(memory->softHeapLimit);
+    }
+    if (memory->hardHeapLimit > 0)
+    {
+        (void)sqlite3_hard_heap_limit64(memory->hardHeapLimit);
+    }
+}
+#ifdef SQLITE_MODULE_STATIC_HEAP
+static void sqlite_configure_static_heap(SQLITE_HANDLE_DATA * handle)
+{
+    const SQLITE_HEAP_CONFIG * heap = &(handle->heap);
+    sqlite_instances++;
+    if (static_heap != NULL || static_page_cache != NULL)
+    {
+        LogInfo("SQLite heap already configured by another module instance");
+    }
+    else
+    {
+        /*both must be configured before anything initializes SQLite*/
+        if (heap->pageCacheSlot > 0 && heap->pageCacheCount > 0)
+        {
+            static_page_cache = malloc((size_t)heap->pageCacheSlot * heap->pageCacheCount);
+            if (static_page_cache == NULL)
+            {
+                LogError("unable to allocate %d page cache slots", heap->pageCacheCount);
+            }
+            else if (sqlite3_config(SQLITE_CONFIG_PAGECACHE, static_page_cache, heap->pageCacheSlot, heap->pageCacheCount) != SQLITE_OK)
+            {
+                LogError("unable to configure page cache, SQLite is already initialized");
+                free(static_page_cache);
+                static_page_cache = NULL;
+            }
+        }
+        if (heap->size > 0)
+        {
+            static_heap = malloc(heap->size);
+            if (static_heap == NULL)
+            {
+                LogError("unable to allocate %d bytes of SQLite heap", heap->size);
+            }
+            else if (sqlite3_config(SQLITE_CONFIG_HEAP, static_heap, heap->size, (heap->minAllocation > 0) ? heap->minAllocation : DEFAULT_MIN_ALLOCATION) != SQLITE_OK)
+            {
+                LogError("unable to configure SQLite heap, SQLite is already initialized or lacks SQLITE_ENABLE_MEMSYS5");
+                free(static_heap);
+                static_heap = NULL;
+            }
+        }
+    }
+}
+static void sqlite_release_static_heap(SQLITE_HANDLE_DATA * handle)
+{
+    (void)handle;
+    /*the connection of every other instance may still live in the heap, only the last one to close lets it go*/
+    if (--sqlite_instances == 0 && (static_heap != NULL || static_page_cache != NULL))
+    {
+        /*the buffers can only go once SQLite has shut down and been pointed back at the system allocator*/
+        (void)sqlite3_shutdown();
+        if (static_heap != NULL)
+            (void)sqlite3_config(SQLITE_CONFIG_HEAP, NULL, 0, 0);
+        if (static_page_cache != NULL)
+            (void)sqlite3_config(SQLITE_CONFIG_PAGECACHE, NULL, 0, 0);
+        free(static_heap);
+        free(static_page_cache);
+        static_heap = NULL;
+        static_page_cache = NULL;
+    }
+}
+#endif
+static void sqlite_configure_memory(SQLITE_HANDLE_DATA * handle, const SQLITE_CONFIG * config)
+{
+    handle->memory = config->memory;
+    handle->heap = config->heap;
+#ifdef SQLITE_MODULE_STATIC_HEAP
+    sqlite_configure_static_heap(handle);
+#else
+    if (handle->heap.size > 0 || handle->heap.pageCacheCount > 0)
+    {
+        LogError("heap size and page cache are ignored, the module was built without SQLITE_MODULE_STATIC_HEAP");
+    }
+#endif
+    sqlite_apply_memory_limits(&(handle->memory));
+    /*Codes_SRS_SQLITE_99_022: [ If "arenaSize" is configured, SQLite_Create shall allocate the message arena and leave the parson allocator alone. ]*/
+    if (handle->heap.arenaSize > 0)
+    {
+        handle->arena.buffer = malloc(handle->heap.arenaSize);
+        if (handle->arena.buffer == NULL)
+        {
+            LogError("unable to allocate %d bytes of message arena, using the system allocator", handle->heap.arenaSize);
+        }
+        else
+        {
+            handle->arena.size = handle->heap.arenaSize;
+        }
+    }
+}
+static void sqlite_release_memory(SQLITE_HANDLE_DATA * handle)
+{
+    if (handle->arena.buffer != NULL)
+    {
+        free(handle->arena.buffer);
+        handle->arena.buffer = NULL;
+    }
+#ifdef SQLITE_MODULE_STATIC_HEAP
+    sqlite_release_static_heap(handle);
+#endif
+}
+static void sqlite_check_memory_budget(SQLITE_HANDLE_DATA * handle)
+{
+    sqlite3_int64 budget = (handle->memory.softHeapLimit > 0) ? handle->memory.softHeapLimit : handle->memory.hardHeapLimit;
+    if (budget > 0 && handle->db != NULL)
+    {
+        int threshold = (handle->memory.releaseThreshold > 0) ? handle->memory.releaseThreshold : DEFAULT_RELEASE_THRESHOLD;
+        sqlite3_int64 used = sqlite3_memory_used();
+        if (used >= budget / 100 * threshold)
+        {
+            (void)sqlite3_db_release_memory(handle->db);
+            LogInfo("sqlite memory at %lld of %lld bytes, released caches down to %lld bytes", (long long)used, (long long)budget, (long long)sqlite3_memory_used());
+        }
+    }
+}
+static void sqlite_report_memory(SQLITE_HANDLE_DATA * handle, const SQLITE_REQUEST * request, int publish)
+{
+    JSON_Value * report_value = json_value_init_object();
+    JSON_Object * report = json_value_get_object(report_value);
+    if (report == NULL)
+    {
+        LogError("unable to create memory report");
+    }
+    else
+    {
+        sqlite3_int64 current = 0;
+        sqlite3_int64 highwater = 0;
+        int db_current = 0;
+        int db_highwater = 0;
+
+        json_object_dotset_number(report, "memory.sqliteUsed", (double)sqlite3_memory_used());
+        json_object_dotset_number(report, "memory.sqliteHighwater", (double)sqlite3_memory_highwater(0));
+        if (sqlite3_status64(SQLITE_STATUS_PAGECACHE_OVERFLOW, &current, &highwater, 0) == SQLITE_OK)
+        {
+            json_object_dotset_number(report, "memory.pageCacheOverflow", (double)current);
+        }
+        if (handle->db != NULL && sqlite3_db_status(handle->db, SQLITE_DBSTATUS_CACHE_USED, &db_current, &db_highwater, 0) == SQLITE_OK)
+        {
+            json_object_dotset_number(report, "memory.cacheUsed", (double)db_current);
+        }
+#ifdef GB_MEASURE_MEMORY_FOR_THIS
+        /*gballoc answers SIZE_MAX when the process never initialized it*/
+        size_t gballoc_current = gballoc_getCurrentMemoryUsed();
+        if (gballoc_current != SIZE_MAX)
+        {
+            json_object_dotset_number(report, "memory.gballocCurrent", (double)gballoc_current);
+            json_object_dotset_number(report, "memory.gballocMaximum", (double)gballoc_getMaximumMemoryUsed());
+        }
+#endif
+        json_object_dotset_number(report, "memory.softHeapLimit", (double)handle->memory.softHeapLimit);
+        json_object_dotset_number(report, "memory.hardHeapLimit", (double)handle->memory.hardHeapLimit);
+        json_object_dotset_number(report, "memory.cacheSize", (double)handle->memory.cacheSize);
+        if (handle->arena.buffer != NULL)
+        {
+            json_object_dotset_number(report, "memory.arenaSize", (double)handle->arena.size);
+            json_object_dotset_number(report, "memory.arenaHighwater", (double)handle->arena.highwater);
+            json_object_dotset_number(report, "memory.arenaFallbacks", (double)handle->arena.fallbacks);
+        }
+        if (request->request_id != NULL)
+        {
+            json_object_set_string(report, "requestId", request->request_id);
+        }
+        LogInfo("sqlite memory used %lld bytes", (long long)sqlite3_memory_used());
+        if (publish == 1)
+        {
+            sqlite_publish_json(handle, report_value);
+        }
+    }
+    json_value_free(report_value);
+}
+static void sqlite_configure_slow_log(SQLITE_HANDLE_DATA * handle, const SQLITE_CONFIG * config)
+{
+    handle->slow_query = config->slowQuery;
+    if (handle->slow_query.threshold > 0)
+    {
+        if (handle->slow_query.ringSize <= 0)
+            handle->slow_query.ringSize = DEFAULT_SLOW_RING_SIZE;
+        if (handle->slow_query.sampleRate <= 0)
+            handle->slow_query.sampleRate = 1;
+        handle->slow_ring = malloc(handle->slow_query.ringSize * sizeof(SQLITE_SLOW_QUERY));
+        if (handle->slow_ring == NULL)
+        {
+            LogError("unable to allocate the slow query ring, slow commands are only logged");
+        }
+        else
+        {
+            memset(handle->slow_ring, 0, handle->slow_query.ringSize * sizeof(SQLITE_SLOW_QUERY));
+        }
+    }
+}
+static void sqlite_release_slow_log(SQLITE_HANDLE_DATA * handle)
+{
+    int i;
+    if (handle->slow_ring != NULL)
+    {
+        for (i = 0; i < handle->slow_query.ringSize; i++)
+        {
+            if (handle->slow_ring[i].sql)
+                free(handle->slow_ring[i].sql);
+            if (handle->slow_ring[i].plan)
+                free(handle->slow_ring[i].plan);
+        }
+        free(handle->slow_ring);
+        handle->slow_ring = NULL;
+    }
+}
+/*the plan of the first statement of sql, one line per plan row joined with "; "*/
+static void sqlite_explain(sqlite3 * db, const char * sql, char * plan)
+{
+    sqlite3_stmt * stmt = NULL;
+    size_t length = strlen(sql) + sizeof("EXPLAIN QUERY PLAN ");
+    char * explain = malloc(length);
+
+    plan[0] = '\0';
+    if (explain == NULL)
+    {
+        LogError("unable to allocate EXPLAIN QUERY PLAN");
+    }
+    else
+    {
+        SNPRINTF_S(explain, length, "EXPLAIN QUERY PLAN %s", sql);
+        if (sqlite3_prepare_v2(db, explain, -1, &stmt, NULL) == SQLITE_OK && stmt != NULL)
+        {
+            while (sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                /*columns are id, parent, notused, detail*/
+                const char * detail = (const char *)sqlite3_column_text(stmt, 3);
+                size_t used = strlen(plan);
+                SNPRINTF_S(plan + used, BUFSIZE - used, "%s%s", (used > 0) ? "; " : "", detail ? detail : "");
+            }
+            (void)sqlite3_finalize(stmt);
+        }
+        free(explain);
+    }
+}
+/*Codes_SRS_SQLITE_99_027: [ If a command takes longer than the slowQuery threshold, `Sqlite_Receive` shall log its duration, row count and query plan and keep a sample of them for the "slowlog" request. ]*/
+/*the duration runs from started to finished, which is taken when the statement is done, before its result is serialized and published*/
+static void sqlite_note_slow(SQLITE_HANDLE_DATA * handle, const char * sql, tickcounter_ms_t started, tickcounter_ms_t finished, int rc)
+{
+    char plan[BUFSIZE];
+
+    if (finished - started >= (tickcounter_ms_t)handle->slow_query.threshold)
+    {
+        /*a cancelled command leaves the flag set, it must not interrupt the EXPLAIN*/
+        handle->cancelled = 0;
+        sqlite_explain(handle->db, sql, plan);
+        LogInfo("slow query took %llu ms, %d rows, rc %d: %s, plan: %s", (unsigned long long)(finished - started), result_idx, rc, sql, plan);
+        if (handle->slow_ring != NULL && handle->slow_total % handle->slow_query.sampleRate == 0)
+        {
+            SQLITE_SLOW_QUERY * entry = &(handle->slow_ring[handle->slow_next]);
+            if (entry->sql)
+                free(entry->sql);
+            if (entry->plan)
+                free(entry->plan);
+            entry->sql = NULL;
+            entry->plan = NULL;
+            if (mallocAndStrcpy_s(&(entry->sql), sql) != 0 || mallocAndStrcpy_s(&(entry->plan), plan) != 0)
+            {
+                LogError("unable to keep slow query");
+            }
+            entry->finished = finished;
+            entry->duration = (unsigned long long)(finished - started);
+            entry->rows = result_idx;
+            entry->rc = rc;
+            handle->slow_next = (handle->slow_next + 1) % handle->slow_query.ringSize;
+        }
+        handle->slow_total++;
+    }
+}
+static void sqlite_report_slow_log(SQLITE_HANDLE_DATA * handle, const SQLITE_REQUEST * request, int publish)
+{
+    JSON_Value * report_value = json_value_init_object();
+    JSON_Object * report = json_value_get_object(report_value);
+    if (report == NULL)
+    {
+        LogError("unable to create slow query report");
+    }
+    else
+    {
+        char key[BUFSIZE];
+        tickcounter_ms_t now = 0;
+        int i;
+
+        (void)tickcounter_get_current_ms(handle->tick_counter, &now);
+        json_object_set_number(report, "threshold", (double)handle->slow_query.threshold);
+        json_object_set_number(report, "slowCount", (double)handle->slow_total);
+        /*newest first*/
+        for (i = 0; handle->slow_ring != NULL && i < handle->slow_query.ringSize; i++)
+        {
+            SQLITE_SLOW_QUERY * entry = &(handle->slow_ring[(handle->slow_next + handle->slow_query.ringSize - 1 - i) % handle->slow_query.ringSize]);
+            if (entry->sql == NULL)
+                break;
+            SNPRINTF_S(key, BUFSIZE, "slowlog[%d].sql", i);
+            json_object_dotset_string(report, key, entry->sql);
+            SNPRINTF_S(key, BUFSIZE, "slowlog[%d].plan", i);
+            json_object_dotset_string(report, key, entry->plan ? entry->plan : "");
+            SNPRINTF_S(key, BUFSIZE, "slowlog[%d].durationMs", i);
+            json_object_dotset_number(report, key, (double)entry->duration);
+            SNPRINTF_S(key, BUFSIZE, "slowlog[%d].rows", i);
+            json_object_dotset_number(report, key, (double)entry->rows);
+            SNPRINTF_S(key, BUFSIZE, "slowlog[%d].rc", i);
+            json_object_dotset_number(report, key, (double)entry->rc);
+            SNPRINTF_S(key, BUFSIZE, "slowlog[%d].ageMs", i);
+            json_object_dotset_number(report, key, (double)(now - entry->finished));
+        }
+        if (request->request_id != NULL)
+        {
+            json_object_set_string(report, "requestId", request->request_id);
+        }
+        if (publish == 1)
+        {
+            sqlite_publish_json(handle, report_value);
+        }
+    }
+    json_value_free(report_value);
+}
+static void sqlite_trace_record(SQLITE_HANDLE_DATA * handle, const SQLITE_TRACE * trace)
+{
+    long long duration;
+    int stage;
+    int bucket;
+    for (stage = 0; stage < SQLITE_TRACE_STAGE_COUNT; stage++)
+    {
+        duration = sqlite_trace_stage(trace, (SQLITE_TRACE_STAGE)stage);
+        if (duration >= 0)
+        {
+            SQLITE_HISTOGRAM * histogram = &(handle->histograms[stage]);
+            for (bucket = 0; bucket < TRACE_BUCKETS - 1 && (uint64_t)duration >= ((uint64_t)1 << bucket); bucket++);
+            histogram->buckets[bucket]++;
+            histogram->count++;
+            histogram->sum += (uint64_t)duration;
+            if ((uint64_t)duration > histogram->max)
+                histogram->max = (uint64_t)duration;
+        }
+    }
+}
+/*upper bound in microseconds of the bucket holding the given fraction of the samples*/
+static uint64_t sqlite_histogram_percentile(const SQLITE_HISTOGRAM * histogram, double fraction)
+{
+    uint64_t seen = 0;
+    int bucket;
+    for (bucket = 0; bucket < TRACE_BUCKETS; bucket++)
+    {
+        seen += histogram->buckets[bucket];
+        if ((double)seen >= fraction * (double)histogram->count)
+            break;
+    }
+    return (bucket >= TRACE_BUCKETS - 1) ? histogram->max : ((uint64_t)1 << bucket);
+}
+/*Codes_SRS_SQLITE_99_035: [ If the content of messageHandle has "requestType" set to "trace", `Sqlite_Receive` shall publish the count, mean, maximum and percentiles of every traced stage. ]*/
+static void sqlite_report_trace(SQLITE_HANDLE_DATA * handle, const SQLITE_REQUEST * request, int publish)
+{
+    JSON_Value * report_value = json_value_init_object();
+    JSON_Object * report = json_value_get_object(report_value);
+    if (report == NULL)
+    {
+        LogError("unable to create trace report");
+    }
+    else
+    {
+        char key[BUFSIZE];
+        int stage;
+        int bucket;
+        json_object_set_number(report, "trace", (double)handle->trace);
+        for (stage = 0; stage < SQLITE_TRACE_STAGE_COUNT; stage++)
+        {
+            const SQLITE_HISTOGRAM * histogram = &(handle->histograms[stage]);
+            if (histogram->count == 0)
+                continue;
+            SNPRINTF_S(key, BUFSIZE, "stages.%s.count", trace_stage_names[stage]);
+            json_object_dotset_number(report, key, (double)histogram->count);
+            SNPRINTF_S(key, BUFSIZE, "stages.%s.meanUs", trace_stage_names[stage]);
+            json_object_dotset_number(report, key, (double)histogram->sum / (double)histogram->count);
+            SNPRINTF_S(key, BUFSIZE, "stages.%s.maxUs", trace_stage_names[stage]);
+            json_object_dotset_number(report, key, (double)histogram->max);
+            SNPRINTF_S(key, BUFSIZE, "stages.%s.p50Us", trace_stage_names[stage]);
+            json_object_dotset_number(report, key, (double)sqlite_histogram_percentile(histogram, 0.5));
+            SNPRINTF_S(key, BUFSIZE, "stages.%s.p99Us", trace_stage_names[stage]);
+            json_object_dotset_number(report, key, (double)sqlite_histogram_percentile(histogram, 0.99));
+            for (bucket = 0; bucket < TRACE_BUCKETS; bucket++)
+            {
+                if (histogram->buckets[bucket] > 0)
+                {
+                    /*keyed by the exclusive upper bound of the bucket*/
+                    SNPRINTF_S(key, BUFSIZE, "stages.%s.histogram.%llu", trace_stage_names[stage], (unsigned long long)((uint64_t)1 << bucket));
+                    json_object_dotset_number(report, key, (double)histogram->buckets[bucket]);
+                }
+            }
+        }
+        if (request->request_id != NULL)
+        {
+            json_object_set_string(report, "requestId", request->request_id);
+        }
+        if (publish == 1)
+        {
+            sqlite_publish_json(handle, report_value);
+        }
+    }
+    json_value_free(report_value);
+}
+/*Codes_SRS_SQLITE_99_040: [ If the content of messageHandle has "requestType" set to "admission", `Sqlite_Receive` shall publish the rate, policy and admitted, dropped, rejected and coalesced commands of every rate limited source, and the queued and refused commands of every lane. ]*/
+static void sqlite_report_admission(SQLITE_HANDLE_DATA * handle, const SQLITE_REQUEST * request, int publish)
+{
+    JSON_Value * report_value = json_value_init_object();
+    JSON_Object * report = json_value_get_object(report_value);
+    if (report == NULL)
+    {
+        LogError("unable to create admission report");
+    }
+    else
+    {
+        char key[BUFSIZE];
+        SQLITE_SOURCE * source;
+        for (source = handle->sources; source != NULL; source = source->p_next)
+        {
+            const SQLITE_RATE_STATE * state = source->rateState;
+            if (source->rateCommands == 0 && source->rateBytes == 0)
+                continue;
+            SNPRINTF_S(key, BUFSIZE, "sources.%s.commandsPerSecond", source->id);
+            json_object_dotset_number(report, key, (double)source->rateCommands);
+            SNPRINTF_S(key, BUFSIZE, "sources.%s.bytesPerSecond", source->id);
+            json_object_dotset_number(report, key, (double)source->rateBytes);
+            SNPRINTF_S(key, BUFSIZE, "sources.%s.policy", source->id);
+            json_object_dotset_string(report, key, rate_policy_names[source->ratePolicy]);
+            /*the counters start with the first command of the source*/
+            SNPRINTF_S(key, BUFSIZE, "sources.%s.admitted", source->id);
+            json_object_dotset_number(report, key, (state != NULL) ? (double)state->admitted : 0);
+            SNPRINTF_S(key, BUFSIZE, "sources.%s.dropped", source->id);
+            json_object_dotset_number(report, key, (state != NULL) ? (double)state->dropped : 0);
+            SNPRINTF_S(key, BUFSIZE, "sources.%s.rejected", source->id);
+            json_object_dotset_number(report, key, (state != NULL) ? (double)state->rejected : 0);
+            SNPRINTF_S(key, BUFSIZE, "sources.%s.coalesced", source->id);
+            json_object_dotset_number(report, key, (state != NULL) ? (double)state->coalesced : 0);
+            SNPRINTF_S(key, BUFSIZE, "sources.%s.held", source->id);
+            json_object_dotset_number(report, key, (state != NULL && state->pending != NULL) ? 1 : 0);
+        }
+        if (handle->scheduler && Lock(handle->queue_lock) == LOCK_OK)
+        {
+            int lane_id;
+            for (lane_id = 0; lane_id < SQLITE_LANE_COUNT; lane_id++)
+            {
+                const SQLITE_LANE * lane = &(handle->lanes[lane_id]);
+                SNPRINTF_S(key, BUFSIZE, "lanes.%s.queued", lane_names[lane_id]);
+                json_object_dotset_number(report, key, (double)lane->depth);
+                SNPRINTF_S(key, BUFSIZE, "lanes.%s.capacity", lane_names[lane_id]);
+                json_object_dotset_number(report, key, (double)lane->capacity);
+                SNPRINTF_S(key, BUFSIZE, "lanes.%s.refused", lane_names[lane_id]);
+                json_object_dotset_number(report, key, (double)lane->refused);
+            }
+            (void)Unlock(handle->queue_lock);
+        }
+        if (request->request_id != NULL)
+        {
+            json_object_set_string(report, "requestId", request->request_id);
+        }
+        if (publish == 1)
+        {
+            sqlite_publish_json(handle, report_value);
+        }
+    }
+    json_value_free(report_value);
+}
+/*Codes_SRS_SQLITE_99_048: [ If a command runs past its "timeout", the module shall interrupt it and publish an error naming the timeout with its "requestId". ]*/
+static int sqlite_progress(void * context)
+{
+    SQLITE_HANDLE_DATA * handle = (SQLITE_HANDLE_DATA *)context;
+    tickcounter_ms_t now;
+    int abort_query = 0;
+
+    if (handle->cancelled)
+    {
+        abort_query = 1;
+    }
+    else if (handle->deadline != 0 && tickcounter_get_current_ms(handle->tick_counter, &now) == 0 && now >= handle->deadline)
+    {
+        handle->timed_out = 1;
+        abort_query = 1;
+    }
+    return abort_query;
+}
+static void sqlite_begin_request(SQLITE_HANDLE_DATA * handle, const SQLITE_REQUEST * request)
+{
+    tickcounter_ms_t now;
+
+    handle->cancelled = 0;
+    handle->timed_out = 0;
+    handle->deadline = 0;
+    if (handle->current_trace != NULL && handle->current_trace->stamps[SQLITE_TRACE_EXEC_START] == 0)
+    {
+        sqlite_trace_stamp(handle, SQLITE_TRACE_EXEC_START);
+    }
+    if (request != NULL)
+    {
+        if (request->timeout > 0 && tickcounter_get_current_ms(handle->tick_counter, &now) == 0)
+        {
+            handle->deadline = now + request->timeout;
+        }
+        if (request->request_id != NULL && Lock(handle->request_lock) == LOCK_OK)
+        {
+            handle->active_request = request->request_id;
+            (void)Unlock(handle->request_lock);
+        }
+    }
+}
+static void sqlite_end_request(SQLITE_HANDLE_DATA * handle, const SQLITE_REQUEST * request)
+{
+    sqlite_trace_stamp(handle, SQLITE_TRACE_EXEC_END);
+    if (request != NULL && request->request_id != NULL && Lock(handle->request_lock) == LOCK_OK)
+    {
+        handle->active_request = NULL;
+        (void)Unlock(handle->request_lock);
+    }
+    handle->deadline = 0;
+}
+static bool sqlite_drop_queued(SQLITE_HANDLE_DATA * handle, const char * request_id)
+{
+    bool dropped = false;
+    int lane_id;
+    if (Lock(handle->queue_lock) == LOCK_OK)
+    {
+        for (lane_id = 0; lane_id < SQLITE_LANE_COUNT; lane_id++)
+        {
+            SQLITE_LANE * lane = &(handle->lanes[lane_id]);
+            SQLITE_WORK_ITEM * previous = NULL;
+            SQLITE_WORK_ITEM * item = lane->head;
+            while (item != NULL)
+            {
+                SQLITE_WORK_ITEM * next = item->p_next;
+                if (item->request_id != NULL && strcmp(item->request_id, request_id) == 0)
+                {
+                    if (previous == NULL)
+                        lane->head = next;
+                    else
+                        previous->p_next = next;
+                    if (lane->tail == item)
+                        lane->tail = previous;
+                    lane->depth--;
+                    if (item->source != NULL)
+                        item->source->queued--;
+                    json_value_free(item->json);
+                    free(item);
+                    dropped = true;
+                }
+                else
+                {
+                    previous = item;
+                }
+                item = next;
+            }
+        }
+        (void)Unlock(handle->queue_lock);
+    }
+    return dropped;
+}
+/*publishes {"error": text} for a command that is not executed, with its "requestId"*/
+static void sqlite_reply_error(SQLITE_HANDLE_DATA * handleData, const char * text, const SQLITE_SOURCE * match_source, const SQLITE_REQUEST * request)
+{
+    JSON_Value * error_value = json_value_init_object();
+    JSON_Object * error = json_value_get_object(error_value);
+    if (error == NULL)
+    {
+        LogError("unable to create error reply");
+    }
+    else
+    {
+        const char * extra_properties[5];
+        extra_properties[0] = "requestId";
+        extra_properties[1] = request->request_id;
+        extra_properties[2] = "target";
+        extra_properties[3] = request->reply_to;
+        extra_properties[4] = NULL;
+        json_object_set_string(error, "error", text);
+        if (request->request_id != NULL)
+        {
+            json_object_set_string(error, "requestId", request->request_id);
+        }
+        /*the receiving thread must not touch msgConfig, a command from IoT Hub is answered there with "macAddress"*/
+        sqlite_publish_direct(handleData, error_value, extra_properties, (match_source != NULL) ? 1 : 0);
+    }
+    json_value_free(error_value);
+}
+static void sqlite_cancel(SQLITE_HANDLE_DATA * handle, const char * request_id)
+{
+    if (request_id == NULL)
+    {
+        LogError("cancel request without requestId");
+    }
+    else if (Lock(handle->request_lock) != LOCK_OK)
+    {
+        LogError("unable to lock request state");
+    }
+    else
+    {
+        if (handle->scheduler && sqlite_drop_queued(handle, request_id))
+        {
+            LogInfo("removed queued request %s", request_id);
+        }
+        if (handle->active_request != NULL && strcmp(handle->active_request, request_id) == 0)
+        {
+            handle->cancelled = 1;
+            sqlite3_interrupt(handle->db);
+            LogInfo("cancelling request %s", request_id);
+        }
+        else
+        {
+            LogInfo("request %s is not running, nothing to cancel", request_id);
+        }
+        (void)Unlock(handle->request_lock);
+    }
+}
+static const char * sqlite_parse_request(JSON_Object * obj, SQLITE_REQUEST * request)
+{
+    const char * timeout = json_object_get_string(obj, "timeout");
+    request->request_id = json_object_get_string(obj, "requestId");
+    request->reply_to = json_object_get_string(obj, "replyTo");
+    request->reply = json_object_get_string(obj, "reply");
+    request->timeout = (timeout != NULL) ? atoi(timeout) : 0;
+    request->publish = (request->reply == NULL || strcmp(request->reply, "none") != 0) ? 1 : 0;
+    request->local = 0;
+    return json_object_get_string(obj, "requestType");
+}
+static void sqlite_stmt_cache_clear(SQLITE_HANDLE_DATA * handle)
+{
+    int i;
+    for (i = 0; i < STMT_CACHE_SIZE; i++)
+    {
+        if (handle->stmt_cache[i].stmt != NULL)
+        {
+            (void)sqlite3_finalize(handle->stmt_cache[i].stmt);
+            free(handle->stmt_cache[i].sql);
+            handle->stmt_cache[i].stmt = NULL;
+            handle->stmt_cache[i].sql = NULL;
+        }
+    }
+}
+/*returns the cached statement for sql, preparing it in the least recently used slot on a miss*/
+static sqlite3_stmt * sqlite_stmt_get(SQLITE_HANDLE_DATA * handle, const char * sql, char * error)
+{
+    sqlite3_stmt * result = NULL;
+    SQLITE_STMT_CACHE_ENTRY * victim = &(handle->stmt_cache[0]);
+    int i;
+    for (i = 0; i < STMT_CACHE_SIZE; i++)
+    {
+        SQLITE_STMT_CACHE_ENTRY * entry = &(handle->stmt_cache[i]);
+        if (entry->stmt != NULL && strcmp(entry->sql, sql) == 0)
+        {
+            result = entry->stmt;
+            entry->last_used = ++handle->stmt_clock;
+            break;
+        }
+        if (entry->stmt == NULL || (victim->stmt != NULL && entry->last_used < victim->last_used))
+        {
+            victim = entry;
+        }
+    }
+    if (result == NULL)
+    {
+        const char * tail = NULL;
+        char * copy = NULL;
+        if (sqlite3_prepare_v2(handle->db, sql, -1, &result, &tail) != SQLITE_OK)
+        {
+            SNPRINTF_S(error, BUFSIZE, "%s", sqlite3_errmsg(handle->db));
+            result = NULL;
+        }
+        else if (result == NULL)
+        {
+            SNPRINTF_S(error, BUFSIZE, "sqlCommand is empty");
+        }
+        else if (tail != NULL && tail[strspn(tail, " \t\r\n;")] != '\0')
+        {
+            SNPRINTF_S(error, BUFSIZE, "params require a single statement in sqlCommand");
+            (void)sqlite3_finalize(result);
+            result = NULL;
+        }
+        else if (mallocAndStrcpy_s(&copy, sql) != 0)
+        {
+            /*still usable, just not kept*/
+            LogError("unable to cache statement");
+        }
+        else
+        {
+            if (victim->stmt != NULL)
+            {
+                (void)sqlite3_finalize(victim->stmt);
+                free(victim->sql);
+            }
+            victim->stmt = result;
+            victim->sql = copy;
+            victim->last_used = ++handle->stmt_clock;
+        }
+    }
+    return result;
+}
+static bool sqlite_stmt_is_cached(SQLITE_HANDLE_DATA * handle, sqlite3_stmt * stmt)
+{
+    int i;
+    for (i = 0; i < STMT_CACHE_SIZE; i++)
+    {
+        if (handle->stmt_cache[i].stmt == stmt)
+            return true;
+    }
+    return false;
+}
+static int hex_digit(char c)
+{
+    return (c >= '0' && c <= '9') ? c - '0' :
+        (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+        (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+}
+static int sqlite_bind_blob_hex(sqlite3_stmt * stmt, int index, const char * hex)
+{
+    int rc;
+    size_t length = (hex != NULL) ? strlen(hex) : 0;
+    unsigned char * blob;
+    if (hex == NULL || length % 2 != 0)
+    {
+        rc = SQLITE_MISMATCH;
+    }
+    else if ((blob = (unsigned char *)malloc(length / 2 + 1)) == NULL)
+    {
+        rc = SQLITE_NOMEM;
+    }
+    else
+    {
+        size_t i;
+        rc = SQLITE_OK;
+        for (i = 0; i < length / 2; i++)
+        {
+            int high = hex_digit(hex[2 * i]);
+            int low = hex_digit(hex[2 * i + 1]);
+            if (high < 0 || low < 0)
+            {
+                rc = SQLITE_MISMATCH;
+                break;
+            }
+            blob[i] = (unsigned char)((high << 4) | low);
+        }
+        if (rc == SQLITE_OK)
+        {
+            rc = sqlite3_bind_blob(stmt, index, blob, (int)(length / 2), SQLITE_TRANSIENT);
+        }
+        free(blob);
+    }
+    return rc;
+}
+static int sqlite_bind_value(sqlite3_stmt * stmt, int index, const JSON_Value * value)
+{
+    int rc;
+    switch (json_value_get_type(value))
+    {
+    case JSONNull:
+        rc = sqlite3_bind_null(stmt, index);
+        break;
+    case JSONBoolean:
+        rc = sqlite3_bind_int64(stmt, index, json_value_get_boolean(value) ? 1 : 0);
+        break;
+    case JSONNumber:
+    {
+        double number = json_value_get_number(value);
+        /*JSON has one number type, integral values within range keep integer affinity*/
+        if (number >= -9007199254740992.0 && number <= 9007199254740992.0 && number == (double)(sqlite3_int64)number)
+            rc = sqlite3_bind_int64(stmt, index, (sqlite3_int64)number);
+        else
+            rc = sqlite3_bind_double(stmt, index, number);
+        break;
+    }
+    case JSONString:
+        /*the json outlives the step, no copy needed*/
+        rc = sqlite3_bind_text(stmt, index, json_value_get_string(value), -1, SQLITE_STATIC);
+        break;
+    case JSONObject:
+        rc = sqlite_bind_blob_hex(stmt, index, json_object_get_string(json_value_get_object(value), "blob"));
+        break;
+    default:
+        rc = SQLITE_MISMATCH;
+        break;
+    }
+    return rc;
+}
+static int sqlite_bind_named(sqlite3_stmt * stmt, const char * name)
+{
+    static const char prefixes[] = ":@$";
+    char prefixed[BUFSIZE];
+    int index = sqlite3_bind_parameter_index(stmt, name);
+    int i;
+    for (i = 0; index == 0 && prefixes[i] != '\0'; i++)
+    {
+        SNPRINTF_S(prefixed, BUFSIZE, "%c%s", prefixes[i], name);
+        index = sqlite3_bind_parameter_index(stmt, prefixed);
+    }
+    return index;
+}
+/*params is an array bound by position or an object bound by name*/
+static int sqlite_bind_params(sqlite3_stmt * stmt, const JSON_Value * params, char * error)
+{
+    int rc = SQLITE_OK;
+    size_t i;
+    if (json_value_get_type(params) == JSONArray)
+    {
+        JSON_Array * array = json_value_get_array(params);
+        size_t count = json_array_get_count(array);
+        if (count > (size_t)sqlite3_bind_parameter_count(stmt))
+        {
+            SNPRINTF_S(error, BUFSIZE, "%d params given, sqlCommand has %d", (int)count, sqlite3_bind_parameter_count(stmt));
+            rc = SQLITE_RANGE;
+        }
+        for (i = 0; i < count && rc == SQLITE_OK; i++)
+        {
+            rc = sqlite_bind_value(stmt, (int)i + 1, json_array_get_value(array, i));
+            if (rc != SQLITE_OK)
+                SNPRINTF_S(error, BUFSIZE, "unable to bind param %d", (int)i + 1);
+        }
+    }
+    else
+    {
+        JSON_Object * object = json_value_get_object(params);
+        size_t count = json_object_get_count(object);
+        for (i = 0; i < count && rc == SQLITE_OK; i++)
+        {
+            const char * name = json_object_get_name(object, i);
+            int index = sqlite_bind_named(stmt, name);
+            if (index == 0)
+            {
+                SNPRINTF_S(error, BUFSIZE, "sqlCommand has no parameter %s", name);
+                rc = SQLITE_RANGE;
+            }
+            else
+            {
+                rc = sqlite_bind_value(stmt, index, json_object_get_value(object, name));
+                if (rc != SQLITE_OK)
+                    SNPRINTF_S(error, BUFSIZE, "unable to bind param %s", name);
+            }
+        }
+    }
+    return rc;
+}
+/*prepare (or reuse), bind, step; rows are added to the result like sqlite3_exec's callback does*/
+static int sqlite_exec_bound(SQLITE_HANDLE_DATA * handle, const char * sql, const JSON_Value * params, char * error)
+{
+    int rc;
+    sqlite3_stmt * stmt = sqlite_stmt_get(handle, sql, error);
+    if (stmt == NULL)
+    {
+        rc = SQLITE_ERROR;
+    }
+    else
+    {
+        rc = sqlite_bind_params(stmt, params, error);
+        if (rc == SQLITE_OK)
+        {
+            int columns = sqlite3_column_count(stmt);
+            while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+            {
+                int i;
+                for (i = 0; i < columns; i++)
+                {
+                    add_result_column(sqlite3_column_name(stmt, i), (const char *)sqlite3_column_text(stmt, i));
+                }
+                result_idx++;
+            }
+            if (rc == SQLITE_DONE)
+            {
+                rc = SQLITE_OK;
+            }
+            else
+            {
+                SNPRINTF_S(error, BUFSIZE, "%s", sqlite3_errmsg(handle->db));
+            }
+        }
+        (void)sqlite3_reset(stmt);
+        (void)sqlite3_clear_bindings(stmt);
+        if (!sqlite_stmt_is_cached(handle, stmt))
+        {
+            (void)sqlite3_finalize(stmt);
+        }
+    }
+    return rc;
+}
+/*fills errorText for a failed command, interruptions are reported by their cause*/
+static void sqlite_format_error(SQLITE_HANDLE_DATA * handle, int rc, const SQLITE_REQUEST * request, const char * message)
+{
+    if (rc == SQLITE_INTERRUPT && handle->timed_out)
+    {
+        SNPRINTF_S(errorText, BUFSIZE, "query timed out after %d ms", request->timeout);
+    }
+    else if (rc == SQLITE_INTERRUPT && handle->cancelled)
+    {
+        SNPRINTF_S(errorText, BUFSIZE, "query cancelled");
+    }
+    else
+    {
+        SNPRINTF_S(errorText, BUFSIZE, "%s", (message != NULL && message[0] != '\0') ? message : "unknown error");
+    }
+}
+/*a full page of a range request carries the key of its last row as "<rowid>:<hex of the key value>"*/
+static void sqlite_page_cursor(JSON_Object * result)
+{
+    char cursor[sizeof(currentPage->rowid) + 2 * BUFSIZE];
+    const unsigned char * p;
+    size_t length;
+
+    if (currentPage != NULL && result_idx == currentPage->size)
+    {
+        SNPRINTF_S(cursor, sizeof(cursor), "%s:", currentPage->rowid);
+        length = strlen(cursor);
+        for (p = (const unsigned char *)currentPage->value; *p != '\0'; p++)
+        {
+            SNPRINTF_S(cursor + length, sizeof(cursor) - length, "%02x", *p);
+            length += 2;
+        }
+        json_object_set_string(result, "cursor", cursor);
+    }
+}
+static void sqlite_exec(SQLITE_HANDLE_DATA* handle, char* sql, const JSON_Value * params, int publish, const SQLITE_REQUEST * request)
+{
+    char *zErrMsg = 0;
+    char boundError[BUFSIZE] = { 0 };
+    int rc;
+    tickcounter_ms_t started = 0;
+    tickcounter_ms_t finished = 0;
+    int timed;
+    error_root_value = json_value_init_object();
+    error_root_object = json_value_get_object(error_root_value);
+    result_root_value = json_value_init_object();
+    result_root_object = json_value_get_object(result_root_value);
+    char *serialized_string = NULL;
+
+    /* Execute SQL statement */
+    if (handle != NULL && sql != NULL)
+    {
+        result_idx = 0;
+        timed = (handle->slow_query.threshold > 0 && tickcounter_get_current_ms(handle->tick_counter, &started) == 0);
+
+        sqlite_begin_request(handle, request);
+        if (params == NULL)
+            rc = sqlite3_exec(handle->db, sql, callback, 0, &zErrMsg);
+        else
+            rc = sqlite_exec_bound(handle, sql, params, boundError);
+        sqlite_end_request(handle, request);
+        if (timed && tickcounter_get_current_ms(handle->tick_counter, &finished) != 0)
+        {
+            timed = 0;
+        }
+        if (rc != SQLITE_OK) 
+        {
+            sqlite_format_error(handle, rc, request, zErrMsg ? zErrMsg : boundError);
+            LogError("SQL error: %s", errorText);    
+            json_object_set_string(error_root_object, "error", errorText);
+            if (request != NULL && request->request_id != NULL)
+            {
+                json_object_set_string(error_root_object, "requestId", request->request_id);
+            }
+
+            serialized_string = sqlite_serialize(handle, error_root_value);
+            msgConfig.source = (const unsigned char *)serialized_string;
+            msgConfig.size = strlen(serialized_string);
+            if (publish == 1)
+            {
+                sqlite_publish(handle->broker, handle);
+            }
+
+            sqlite3_free(zErrMsg);    
+        }
+        else 
+        {
+            LogInfo("operation done successfully");
+            sqlite_page_cursor(result_root_object);
+
+            serialized_string = sqlite_serialize(handle, result_root_value);
+            msgConfig.source = (const unsigned char *)serialized_string;
+            msgConfig.size = strlen(serialized_string);
+            if (publish == 1)
+            {
+                sqlite_publish(handle->broker, handle);
+            }
+        }
+        sqlite_serialized_free(handle, serialized_string);
+        if (timed)
+        {
+            sqlite_note_slow(handle, sql, started, finished, rc);
+        }
+        sqlite_check_memory_budget(handle);
+    }
+    json_value_free(error_root_value);
+    json_value_free(result_root_value);
+}
+static int sqlite_exec_quiet(SQLITE_HANDLE_DATA * handle, const char * sql)
+{
+    int rc = sqlite3_exec(handle->db, sql, NULL, NULL, NULL);
+    if (rc != SQLITE_OK)
+    {
+        LogError("%s failed: %s", sql, sqlite3_errmsg(handle->db));
+    }
+    return rc;
+}
+/*runs each statement in its own savepoint inside one outer savepoint, which is a transaction unless one is already open*/
+static void sqlite_exec_batch(SQLITE_HANDLE_DATA * handle, JSON_Array * statements, int atomic, int publish, const SQLITE_REQUEST * request)
+{
+    size_t count = json_array_get_count(statements);
+    size_t i;
+    int failed = 0;
+    int failed_at = -1;
+    int rc = SQLITE_OK;
+    char key[BUFSIZE];
+
+    result_root_value = json_value_init_object();
+    result_root_object = json_value_get_object(result_root_value);
+
+    sqlite_begin_request(handle, request);
+    rc = sqlite_exec_quiet(handle, "SAVEPOINT gw_batch;");
+    for (i = 0; i < count && rc == SQLITE_OK; i++)
+    {
+        JSON_Object * statement = json_array_get_object(statements, i);
+        const char * sql = (statement != NULL) ? json_object_get_string(statement, "sqlCommand") : NULL;
+        JSON_Value * params = (statement != NULL) ? json_object_get_value(statement, "params") : NULL;
+        char * zErrMsg = NULL;
+        char boundError[BUFSIZE] = { 0 };
+        int statement_rc;
+        int in_savepoint = 0;
+
+        SNPRINTF_S(resultPrefix, BUFSIZE, "batch[%d].", (int)i);
+        result_idx = 0;
+        if (sql == NULL)
+        {
+            statement_rc = SQLITE_MISUSE;
+            SNPRINTF_S(boundError, BUFSIZE, "sqlCommand is missing");
+        }
+        else if ((statement_rc = sqlite_exec_quiet(handle, "SAVEPOINT gw_statement;")) == SQLITE_OK)
+        {
+            in_savepoint = 1;
+            if (params == NULL)
+                statement_rc = sqlite3_exec(handle->db, sql, callback, 0, &zErrMsg);
+            else
+                statement_rc = sqlite_exec_bound(handle, sql, params, boundError);
+            if (statement_rc == SQLITE_OK)
+            {
+                SNPRINTF_S(key, BUFSIZE, "batch[%d].changes", (int)i);
+                json_object_dotset_number(result_root_object, key, (double)sqlite3_changes(handle->db));
+                (void)sqlite_exec_quiet(handle, "RELEASE gw_statement;");
+            }
+        }
+        if (statement_rc != SQLITE_OK)
+        {
+            sqlite_format_error(handle, statement_rc, request, zErrMsg ? zErrMsg : boundError);
+            if (statement_rc == SQLITE_INTERRUPT)
+            {
+                /*the rollbacks below must not be interrupted as well*/
+                handle->deadline = 0;
+                handle->cancelled = 0;
+            }
+            if (in_savepoint)
+            {
+                /*only this statement's effects are undone*/
+                (void)sqlite_exec_quiet(handle, "ROLLBACK TO gw_statement;");
+                (void)sqlite_exec_quiet(handle, "RELEASE gw_statement;");
+            }
+            LogError("batch statement %d failed: %s", (int)i, errorText);
+            SNPRINTF_S(key, BUFSIZE, "batch[%d].error", (int)i);
+            json_object_dotset_string(result_root_object, key, errorText);
+            failed++;
+            if (failed_at < 0)
+                failed_at = (int)i;
+            /*an interrupted batch has no time left for the rest*/
+            if (atomic || statement_rc == SQLITE_INTERRUPT)
+                rc = statement_rc;
+        }
+        sqlite3_free(zErrMsg);
+    }
+    resultPrefix[0] = '\0';
+    if (failed_at < 0 && rc != SQLITE_OK)
+    {
+        SNPRINTF_S(errorText, BUFSIZE, "unable to start batch: %s", sqlite3_errmsg(handle->db));
+        json_object_set_string(result_root_object, "error", errorText);
+    }
+    else if (rc != SQLITE_OK && atomic)
+    {
+        (void)sqlite_exec_quiet(handle, "ROLLBACK TO gw_batch;");
+        (void)sqlite_exec_quiet(handle, "RELEASE gw_batch;");
+        SNPRINTF_S(errorText, BUFSIZE, "statement %d failed, batch rolled back", failed_at);
+        json_object_set_string(result_root_object, "error", errorText);
+    }
+    else if (sqlite_exec_quiet(handle, "RELEASE gw_batch;") != SQLITE_OK)
+    {
+        /*the commit itself failed, nothing was applied*/
+        (void)sqlite_exec_quiet(handle, "ROLLBACK TO gw_batch;");
+        (void)sqlite_exec_quiet(handle, "RELEASE gw_batch;");
+        SNPRINTF_S(errorText, BUFSIZE, "unable to commit batch: %s", sqlite3_errmsg(handle->db));
+        json_object_set_string(result_root_object, "error", errorText);
+    }
+    sqlite_end_request(handle, request);
+
+    json_object_set_number(result_root_object, "statements", (double)count);
+    json_object_set_number(result_root_object, "failed", (double)failed);
+    if (failed_at >= 0)
+    {
+        json_object_set_number(result_root_object, "failedStatement", (double)failed_at);
+    }
+    if (request != NULL && request->request_id != NULL)
+    {
+        json_object_set_string(result_root_object, "requestId", request->request_id);
+    }
+    if (publish == 1)
+    {
+        sqlite_publish_json(handle, result_root_value);
+    }
+    sqlite_check_memory_budget(handle);
+    json_value_free(result_root_value);
+}
+//select * from sqlite_master where type = 'trigger'; list all triggers
+static void sqlite_build_trigger(SQLITE_SOURCE * src_table, char * sql_drop_trigger, char * sql_trigger)
+{
+	SNPRINTF_S(sql_drop_trigger, BUFSIZE, "DROP TRIGGER IF EXISTS %s_size_control;", src_table->table);
+	SNPRINTF_S(sql_trigger, BUFSIZE, "CREATE TRIGGER %s_size_control INSERT ON %s WHEN (SELECT count(*) from %s)>%d\n"
+		"BEGIN\n"
+		"DELETE FROM %s WHERE rowid <= (SELECT max(rowid) - %d FROM %s);\n"
+		"END;",
+        src_table->table, src_table->table, src_table->table, src_table->limit,
+        src_table->table, src_table->limit, src_table->table
+        );
+}
+//PRAGMA table_info('TABLENAME'); list all columns of 'TABLENAME'
+static void sqlite_build_create_table(SQLITE_SOURCE * src_table, const char * table, char * sql_create)
+{
+    char sql_primary[BUFSIZE] = { 0 };
+    int index = 0;
+    SQLITE_COLUMN *column = src_table->columns;
+
+    SNPRINTF_S(sql_create + index, BUFSIZE - index, "create table if not exists %s (", table);
+    SNPRINTF_S(sql_primary + index, BUFSIZE - index, "PRIMARY KEY (");
+    while (column)
+    {
+        //construct primary key
+        if (column->primaryKey == 1)
+        {
+            index = strlen(sql_primary);
+            SNPRINTF_S(sql_primary + index, BUFSIZE - index, "%s,", column->name);
+        }
+
+        //construct create table
+        index = strlen(sql_create);
+        SNPRINTF_S(sql_create + index, BUFSIZE - index, "%s %s %s,",
+            column->name,
+            column->type,
+            (column->notNull == 1) ? "NOT NULL" : ""
+        );
+        column = column->p_next;
+    }
+    index = strlen(sql_primary);
+    SNPRINTF_S(sql_primary + index - 1, BUFSIZE - index + 1, ")");
+
+    index = strlen(sql_create);
+    SNPRINTF_S(sql_create + index, BUFSIZE - index, "%s);", sql_primary);
+}
+static uint64_t fnv1a(uint64_t hash, const char * text)
+{
+    if (text != NULL)
+    {
+        while (*text)
+        {
+            hash ^= (unsigned char)*text++;
+            hash *= 1099511628211ULL;
+        }
+    }
+    /*separator so that "ab","c" and "a","bc" differ*/
+    hash ^= 0xff;
+    hash *= 1099511628211ULL;
+    return hash;
+}
+/*everything the generated DDL depends on*/
+static void sqlite_fingerprint(SQLITE_SOURCE * src_table, char * fingerprint, size_t size)
+{
+    char number[32];
+    uint64_t hash = 14695981039346656037ULL;
+    SQLITE_COLUMN * column = src_table->columns;
+    SQLITE_INDEX * index;
+
+    SNPRINTF_S(number, sizeof(number), "%d:%d", SCHEMA_VERSION, src_table->limit);
+    hash = fnv1a(hash, number);
+    hash = fnv1a(hash, src_table->table);
+    while (column)
+    {
+        hash = fnv1a(hash, column->name);
+        hash = fnv1a(hash, column->type);
+        SNPRINTF_S(number, sizeof(number), "%d:%d:%d", column->primaryKey, column->notNull, column->fullText);
+        hash = fnv1a(hash, number);
+        column = column->p_next;
+    }
+    SNPRINTF_S(number, sizeof(number), "%d:%d", src_table->partitionInterval, src_table->partitionKeep);
+    hash = fnv1a(hash, number);
+    for (index = src_table->indexes; index != NULL; index = index->p_next)
+    {
+        hash = fnv1a(hash, index->name);
+        hash = fnv1a(hash, index->columns);
+        hash = fnv1a(hash, index->include);
+        hash = fnv1a(hash, index->where);
+        SNPRINTF_S(number, sizeof(number), "%d", index->unique);
+        hash = fnv1a(hash, number);
+    }
+    SNPRINTF_S(fingerprint, size, "%016llx", (unsigned long long)hash);
+}
+static int fingerprint_callback(void * arg, int argc, char **argv, char **azColName)
+{
+    (void)azColName;
+    if (argc > 0 && argv[0] != NULL)
+    {
+        SNPRINTF_S((char *)arg, BUFSIZE, "%s", argv[0]);
+    }
+    return 0;
+}
+static int sqlite_init_exec(sqlite3 * db, const char * sql)
+{
+    char * zErrMsg = NULL;
+    int rc = sqlite3_exec(db, sql, NULL, NULL, &zErrMsg);
+    if (rc != SQLITE_OK)
+    {
+        LogError("SQL error: %s", zErrMsg ? zErrMsg : "unknown error");
+        sqlite3_free(zErrMsg);
+    }
+    return rc;
+}
+static bool sqlite_has_fulltext(SQLITE_SOURCE * src_table)
+{
+    SQLITE_COLUMN * column;
+    for (column = src_table->columns; column != NULL; column = column->p_next)
+    {
+        if (column->fullText)
+            return true;
+    }
+    return false;
+}
+/*appends "<prefix>name, " for every fullText column, without the trailing separator*/
+static void sqlite_fulltext_columns(SQLITE_SOURCE * src_table, const char * prefix, char * list)
+{
+    SQLITE_COLUMN * column;
+    size_t index;
+    list[0] = '\0';
+    for (column = src_table->columns; column != NULL; column = column->p_next)
+    {
+        if (column->fullText)
+        {
+            index = strlen(list);
+            SNPRINTF_S(list + index, BUFSIZE - index, "%s%s%s", (index > 0) ? ", " : "", prefix, column->name);
+        }
+    }
+}
+/*an external content FTS5 index over the fullText columns, kept in sync by triggers and rebuilt from the table,
+  skipped is set when SQLite lacks FTS5 so the index is tried again on the next start*/
+static int sqlite_init_fulltext(sqlite3 * db, SQLITE_SOURCE * src_table, int * skipped)
+{
+    static const char * const suffixes[] = { "ai", "ad", "au" };
+    char sql[BUFSIZE];
+    char columns[BUFSIZE];
+    char new_columns[BUFSIZE];
+    char old_columns[BUFSIZE];
+    const char * t = src_table->table;
+    int rc = SQLITE_OK;
+    int i;
+
+    for (i = 0; i < 3 && rc == SQLITE_OK; i++)
+    {
+        SNPRINTF_S(sql, BUFSIZE, "DROP TRIGGER IF EXISTS %s_fts_%s;", t, suffixes[i]);
+        rc = sqlite_init_exec(db, sql);
+    }
+    if (rc == SQLITE_OK)
+    {
+        SNPRINTF_S(sql, BUFSIZE, "DROP TABLE IF EXISTS %s_fts;", t);
+        rc = sqlite_init_exec(db, sql);
+    }
+    if (rc == SQLITE_OK && sqlite_has_fulltext(src_table) && src_table->partitionInterval > 0)
+    {
+        LogError("full text index on %s not created, it is not supported on partitioned tables", t);
+    }
+    else if (rc == SQLITE_OK && sqlite_has_fulltext(src_table))
+    {
+        sqlite_fulltext_columns(src_table, "", columns);
+        sqlite_fulltext_columns(src_table, "new.", new_columns);
+        sqlite_fulltext_columns(src_table, "old.", old_columns);
+        SNPRINTF_S(sql, BUFSIZE, "CREATE VIRTUAL TABLE %s_fts USING fts5(%s, content='%s', content_rowid='rowid');", t, columns, t);
+        if (sqlite_init_exec(db, sql) != SQLITE_OK)
+        {
+            /*the table is still usable without its index*/
+            LogError("full text index on %s not created, SQLite may lack FTS5", t);
+            *skipped = 1;
+        }
+        else
+        {
+            SNPRINTF_S(sql, BUFSIZE, "CREATE TRIGGER %s_fts_ai AFTER INSERT ON %s BEGIN INSERT INTO %s_fts(rowid, %s) VALUES (new.rowid, %s); END;",
+                t, t, t, columns, new_columns);
+            rc = sqlite_init_exec(db, sql);
+            if (rc == SQLITE_OK)
+            {
+                SNPRINTF_S(sql, BUFSIZE, "CREATE TRIGGER %s_fts_ad AFTER DELETE ON %s BEGIN INSERT INTO %s_fts(%s_fts, rowid, %s) VALUES ('delete', old.rowid, %s); END;",
+                    t, t, t, t, columns, old_columns);
+                rc = sqlite_init_exec(db, sql);
+            }
+            if (rc == SQLITE_OK)
+            {
+                SNPRINTF_S(sql, BUFSIZE, "CREATE TRIGGER %s_fts_au AFTER UPDATE ON %s BEGIN INSERT INTO %s_fts(%s_fts, rowid, %s) VALUES ('delete', old.rowid, %s); INSERT INTO %s_fts(rowid, %s) VALUES (new.rowid, %s); END;",
+                    t, t, t, t, columns, old_columns, t, columns, new_columns);
+                rc = sqlite_init_exec(db, sql);
+            }
+            if (rc == SQLITE_OK)
+            {
+                SNPRINTF_S(sql, BUFSIZE, "INSERT INTO %s_fts(%s_fts) VALUES ('rebuild');", t, t);
+                rc = sqlite_init_exec(db, sql);
+            }
+        }
+    }
+    return rc;
+}
+/*without if_not_exists and prefix this is the text SQLite keeps in sqlite_master.sql for the index, it leaves out the schema*/
+static void sqlite_build_index(const char * prefix, const char * table, SQLITE_INDEX * index, int if_not_exists, char * sql)
+{
+    size_t length;
+    SNPRINTF_S(sql, BUFSIZE, "CREATE %sINDEX %s%s%s_ix_%s ON %s (%s%s%s)",
+        index->unique ? "UNIQUE " : "", if_not_exists ? "IF NOT EXISTS " : "",
+        prefix, table, index->name, table,
+        index->columns, (index->include != NULL) ? ", " : "", (index->include != NULL) ? index->include : "");
+    if (index->where != NULL)
+    {
+        length = strlen(sql);
+        SNPRINTF_S(sql + length, BUFSIZE - length, " WHERE %s", index->where);
+    }
+}
+typedef struct SQLITE_INDEX_SCAN_TAG
+{
+    SQLITE_SOURCE * source;
+    const char * table; //the source's table or one of its partitions
+    char stale[BUFSIZE]; //newline separated names of the indexes to drop
+}SQLITE_INDEX_SCAN;
+static int index_callback(void * arg, int argc, char **argv, char **azColName)
+{
+    SQLITE_INDEX_SCAN * scan = (SQLITE_INDEX_SCAN *)arg;
+    SQLITE_INDEX * index;
+    char sql[BUFSIZE];
+    size_t length;
+    (void)azColName;
+
+    if (argc < 2 || argv[0] == NULL)
+        return 0;
+    for (index = scan->source->indexes; index != NULL; index = index->p_next)
+    {
+        sqlite_build_index("", scan->table, index, 0, sql);
+        if (argv[1] != NULL && strcmp(argv[1], sql) == 0)
+            return 0;
+    }
+    length = strlen(scan->stale);
+    if (length + strlen(argv[0]) + 2 > sizeof(scan->stale))
+    {
+        LogError("too many stale indexes on %s", scan->table);
+        return 1;
+    }
+    SNPRINTF_S(scan->stale + length, sizeof(scan->stale) - length, "%s\n", argv[0]);
+    return 0;
+}
+/*drops the <table>_ix_ indexes that are no longer configured or whose definition changed, then creates the missing ones,
+  prefix is empty or the quoted schema of the table followed by a dot*/
+static int sqlite_init_indexes(sqlite3 * db, SQLITE_SOURCE * src_table, const char * table, const char * prefix)
+{
+    SQLITE_INDEX_SCAN scan;
+    SQLITE_INDEX * index;
+    char sql[BUFSIZE];
+    char * name;
+    char * end;
+    int rc;
+
+    scan.source = src_table;
+    scan.table = table;
+    scan.stale[0] = '\0';
+    SNPRINTF_S(sql, BUFSIZE, "SELECT name, sql FROM %ssqlite_master WHERE type='index' AND tbl_name='%s' AND name LIKE '%s\\_ix\\_%%' ESCAPE '\\';",
+        prefix, table, table);
+    rc = sqlite3_exec(db, sql, index_callback, &scan, NULL);
+    for (name = scan.stale; rc == SQLITE_OK && *name != '\0'; name = end + 1)
+    {
+        end = strchr(name, '\n');
+        *end = '\0';
+        SNPRINTF_S(sql, BUFSIZE, "DROP INDEX IF EXISTS %s%s;", prefix, name);
+        rc = sqlite_init_exec(db, sql);
+    }
+    for (index = src_table->indexes; rc == SQLITE_OK && index != NULL; index = index->p_next)
+    {
+        sqlite_build_index(prefix, table, index, 1, sql);
+        rc = sqlite_init_exec(db, sql);
+    }
+    return rc;
+}
+typedef struct SQLITE_PARTITION_LIST_TAG
+{
+    long long * periods; //newest first
+    size_t count;
+    size_t capacity;
+}SQLITE_PARTITION_LIST;
+static int partition_callback(void * arg, int argc, char **argv, char **azColName)
+{
+    SQLITE_PARTITION_LIST * list = (SQLITE_PARTITION_LIST *)arg;
+    (void)azColName;
+    if (argc < 1 || argv[0] == NULL)
+        return 0;
+    if (list->count == list->capacity)
+    {
+        size_t capacity = (list->capacity == 0) ? 16 : list->capacity * 2;
+        long long * periods = realloc(list->periods, capacity * sizeof(long long));
+        if (periods == NULL)
+        {
+            LogError("unable to list partitions");
+            return 1;
+        }
+        list->periods = periods;
+        list->capacity = capacity;
+    }
+    list->periods[list->count++] = strtoll(argv[0], NULL, 10);
+    return 0;
+}
+/*a view named after the table over the kept partitions, with an INSTEAD OF trigger sending inserts to the current one*/
+static int sqlite_partition_view(sqlite3 * db, SQLITE_SOURCE * src_table, const SQLITE_PARTITION_LIST * list, size_t kept, const char * prefix)
+{
+    const char * t = src_table->table;
+    SQLITE_COLUMN * column;
+    char columns[BUFSIZE] = { 0 };
+    char values[BUFSIZE] = { 0 };
+    size_t size;
+    char * sql;
+    size_t length;
+    size_t i;
+    int rc;
+
+    /*the view lists the declared columns, it has no rowid of its own*/
+    for (column = src_table->columns; column != NULL; column = column->p_next)
+    {
+        length = strlen(columns);
+        SNPRINTF_S(columns + length, BUFSIZE - length, "%s%s", (length > 0) ? ", " : "", column->name);
+        length = strlen(values);
+        SNPRINTF_S(values + length, BUFSIZE - length, "%snew.%s", (length > 0) ? ", " : "", column->name);
+    }
+    size = kept * (strlen(t) + strlen(columns) + 64) + 2 * BUFSIZE;
+    sql = malloc(size);
+    if (sql == NULL)
+    {
+        LogError("unable to allocate the view of %s", t);
+        return SQLITE_NOMEM;
+    }
+    SNPRINTF_S(sql, size, "DROP VIEW IF EXISTS %s%s;", prefix, t);
+    rc = sqlite_init_exec(db, sql);
+    if (rc == SQLITE_OK)
+    {
+        /*names in a view or trigger body are looked up in the schema the view or trigger is created in*/
+        SNPRINTF_S(sql, size, "CREATE VIEW %s%s (%s) AS ", prefix, t, columns);
+        for (i = 0; i < kept; i++)
+        {
+            length = strlen(sql);
+            SNPRINTF_S(sql + length, size - length, "%sSELECT %s FROM %s_p%lld",
+                (i > 0) ? " UNION ALL " : "", columns, t, list->periods[i]);
+        }
+        length = strlen(sql);
+        SNPRINTF_S(sql + length, size - length, ";");
+        rc = sqlite_init_exec(db, sql);
+    }
+    if (rc == SQLITE_OK)
+    {
+        SNPRINTF_S(sql, size, "CREATE TRIGGER %s%s_partition_insert INSTEAD OF INSERT ON %s BEGIN INSERT INTO %s_p%lld (%s) VALUES (%s); END;",
+            prefix, t, t, t, list->periods[0], columns, values);
+        rc = sqlite_init_exec(db, sql);
+    }
+    free(sql);
+    return rc;
+}
+/*Codes_SRS_SQLITE_99_031: [ For a partitioned source, the module shall insert into the partition of the current interval, drop partitions beyond "keep" and expose the kept ones as a view named after the table. ]*/
+static int sqlite_partition_rotate(sqlite3 * db, SQLITE_SOURCE * src_table, long long period, int reindex, const char * prefix)
+{
+    SQLITE_PARTITION_LIST list = { NULL, 0, 0 };
+    const char * t = src_table->table;
+    char partition[BUFSIZE];
+    char sql[BUFSIZE];
+    size_t kept;
+    size_t i;
+    int rc;
+
+    SNPRINTF_S(partition, BUFSIZE, "%s%s_p%lld", prefix, t, period);
+    sqlite_build_create_table(src_table, partition, sql);
+    rc = sqlite_init_exec(db, sql);
+    if (rc == SQLITE_OK)
+    {
+        SNPRINTF_S(partition, BUFSIZE, "%s_p%lld", t, period);
+        rc = sqlite_init_indexes(db, src_table, partition, prefix);
+    }
+    if (rc == SQLITE_OK)
+    {
+        SNPRINTF_S(sql, BUFSIZE, "SELECT CAST(substr(name, %d) AS INTEGER) FROM %ssqlite_master WHERE type='table' AND name GLOB '%s_p[0-9]*' ORDER BY 1 DESC;",
+            (int)strlen(t) + 3, prefix, t);
+        rc = sqlite3_exec(db, sql, partition_callback, &list, NULL);
+    }
+    if (rc == SQLITE_OK)
+    {
+        /*whole partitions go, nothing is deleted row by row*/
+        kept = (list.count < (size_t)src_table->partitionKeep) ? list.count : (size_t)src_table->partitionKeep;
+        for (i = kept; i < list.count && rc == SQLITE_OK; i++)
+        {
+            LogInfo("dropping partition %s_p%lld", t, list.periods[i]);
+            SNPRINTF_S(sql, BUFSIZE, "DROP TABLE IF EXISTS %s%s_p%lld;", prefix, t, list.periods[i]);
+            rc = sqlite_init_exec(db, sql);
+        }
+        for (i = 0; reindex && i < kept && rc == SQLITE_OK; i++)
+        {
+            SNPRINTF_S(partition, BUFSIZE, "%s_p%lld", t, list.periods[i]);
+            rc = sqlite_init_indexes(db, src_table, partition, prefix);
+        }
+        if (rc == SQLITE_OK)
+        {
+            rc = sqlite_partition_view(db, src_table, &list, kept, prefix);
+        }
+    }
+    if (rc == SQLITE_OK)
+    {
+        src_table->partitionCurrent = period;
+    }
+    free(list.periods);
+    return rc;
+}
+static long long sqlite_partition_period(SQLITE_SOURCE * src_table)
+{
+    return (long long)time(NULL) / src_table->partitionInterval;
+}
+/*turns a plain table into the current partition with its rows, or drops the view of a partitioned one so a new empty table can take its name, the partitions keep their rows*/
+static int sqlite_partition_migrate(sqlite3 * db, SQLITE_SOURCE * src_table)
+{
+    char type[BUFSIZE] = { 0 };
+    char sql[BUFSIZE];
+    int rc;
+
+    SNPRINTF_S(sql, BUFSIZE, "SELECT type FROM sqlite_master WHERE name='%s';", src_table->table);
+    rc = sqlite3_exec(db, sql, fingerprint_callback, type, NULL);
+    if (rc == SQLITE_OK && src_table->partitionInterval > 0 && strcmp(type, "table") == 0)
+    {
+        /*the table's indexes keep their names through the rename, drop them and let the partition get its own*/
+        SQLITE_INDEX * indexes = src_table->indexes;
+        src_table->indexes = NULL;
+        rc = sqlite_init_indexes(db, src_table, src_table->table, "");
+        src_table->indexes = indexes;
+    }
+    if (rc == SQLITE_OK && src_table->partitionInterval > 0 && strcmp(type, "table") == 0)
+    {
+        SNPRINTF_S(sql, BUFSIZE, "ALTER TABLE %s RENAME TO %s_p%lld;", src_table->table, src_table->table, sqlite_partition_period(src_table));
+        rc = sqlite_init_exec(db, sql);
+    }
+    else if (rc == SQLITE_OK && src_table->partitionInterval == 0 && strcmp(type, "view") == 0)
+    {
+        LogError("%s is no longer partitioned, its partitions are left in place", src_table->table);
+        SNPRINTF_S(sql, BUFSIZE, "DROP VIEW %s;", src_table->table);
+        rc = sqlite_init_exec(db, sql);
+    }
+    return rc;
+}
+/*runs the DDL of one source only if its stored fingerprint differs or its table is gone, within the caller's transaction*/
+static int sqlite_init_source(sqlite3 * db, SQLITE_SOURCE * src_table)
+{
+    char fingerprint[32];
+    char stored[BUFSIZE] = { 0 };
+    char sql[BUFSIZE];
+    char sql_trigger[BUFSIZE];
+    int fulltext_skipped = 0;
+    int rc;
+
+    sqlite_fingerprint(src_table, fingerprint, sizeof(fingerprint));
+    /*a table dropped by hand leaves its fingerprint behind, so the row only counts while the table or view is still there*/
+    SNPRINTF_S(sql, BUFSIZE, "SELECT fingerprint FROM " SCHEMA_TABLE " WHERE tbl='%s' AND EXISTS (SELECT 1 FROM sqlite_master WHERE name='%s' AND type IN ('table', 'view'));",
+        src_table->table, src_table->table);
+    rc = sqlite3_exec(db, sql, fingerprint_callback, stored, NULL);
+    if (rc == SQLITE_OK && strcmp(stored, fingerprint) == 0)
+    {
+        LogInfo("table %s is up to date", src_table->table);
+    }
+    else
+    {
+        /*a limit that was removed, or a table that became partitioned, must not leave its trigger behind*/
+        sqlite_build_trigger(src_table, sql, sql_trigger);
+        rc = sqlite_init_exec(db, sql);
+        if (rc == SQLITE_OK)
+        {
+            rc = sqlite_init_fulltext(db, src_table, &fulltext_skipped);
+        }
+        if (rc == SQLITE_OK)
+        {
+            rc = sqlite_partition_migrate(db, src_table);
+        }
+        if (rc == SQLITE_OK && src_table->partitionInterval > 0)
+        {
+            rc = sqlite_partition_rotate(db, src_table, sqlite_partition_period(src_table), 1, "");
+        }
+        else if (rc == SQLITE_OK)
+        {
+            sqlite_build_create_table(src_table, src_table->table, sql);
+            rc = sqlite_init_exec(db, sql);
+            if (rc == SQLITE_OK && src_table->limit > 0)
+            {
+                rc = sqlite_init_exec(db, sql_trigger);
+            }
+            if (rc == SQLITE_OK)
+            {
+                rc = sqlite_init_indexes(db, src_table, src_table->table, "");
+            }
+        }
+        if (rc == SQLITE_OK && !fulltext_skipped)
+        {
+            SNPRINTF_S(sql, BUFSIZE, "INSERT OR REPLACE INTO " SCHEMA_TABLE " (tbl, fingerprint) VALUES ('%s', '%s');", src_table->table, fingerprint);
+            rc = sqlite_init_exec(db, sql);
+        }
+    }
+    if (rc == SQLITE_OK && src_table->partitionInterval > 0 && src_table->partitionCurrent != sqlite_partition_period(src_table))
+    {
+        /*the interval may have passed while the gateway was down*/
+        rc = sqlite_partition_rotate(db, src_table, sqlite_partition_period(src_table), 0, "");
+    }
+    return rc;
+}
+typedef struct SQLITE_INIT_JOB_TAG
+{
+    const char * dbPath;
+    SQLITE_SOURCE * sources;
+    THREAD_HANDLE thread;
+    int incremental_vacuum; //1 to switch the file to auto_vacuum=INCREMENTAL so maintenance can return free pages, 2 to rebuild it if it already has tables
+}SQLITE_INIT_JOB;
+static void sqlite_init_auto_vacuum(sqlite3 * db, const char * dbPath, int rebuild)
+{
+    char mode[BUFSIZE] = { 0 };
+    if (sqlite3_exec(db, "PRAGMA auto_vacuum;", fingerprint_callback, mode, NULL) == SQLITE_OK && atoi(mode) != 2 &&
+        sqlite_init_exec(db, "PRAGMA auto_vacuum=INCREMENTAL;") == SQLITE_OK)
+    {
+        /*a file without tables takes the mode right away, one that has tables only when it is rebuilt*/
+        mode[0] = '\0';
+        if (sqlite3_exec(db, "PRAGMA auto_vacuum;", fingerprint_callback, mode, NULL) == SQLITE_OK && atoi(mode) != 2)
+        {
+            if (!rebuild)
+            {
+                LogInfo("%s was created without incremental vacuum, its free pages are not returned unless maintenance rebuild is set", dbPath);
+            }
+            else
+            {
+                /*the whole file is copied, it is locked meanwhile and needs up to twice its size on disk*/
+                LogInfo("rebuilding %s for incremental vacuum", dbPath);
+                if (sqlite_init_exec(db, "VACUUM;") != SQLITE_OK)
+                {
+                    LogError("unable to switch %s to incremental vacuum, free pages will not be returned", dbPath);
+                }
+            }
+        }
+    }
+}
+/*initializes every source stored in one database file, in a single transaction on its own connection*/
+static int sqlite_init_database(void * arg)
+{
+    SQLITE_INIT_JOB * job = (SQLITE_INIT_JOB *)arg;
+    sqlite3 * db = NULL;
+    int rc = sqlite3_open(job->dbPath, &db);
+    if (rc != SQLITE_OK)
+    {
+        LogError("Can't open database %s: %s", job->dbPath, sqlite3_errmsg(db));
+    }
+    else
+    {
+        if (job->incremental_vacuum)
+        {
+            /*VACUUM cannot run inside the init transaction*/
+            sqlite_init_auto_vacuum(db, job->dbPath, job->incremental_vacuum == 2);
+        }
+        rc = sqlite_init_exec(db, "BEGIN IMMEDIATE;");
+        if (rc == SQLITE_OK)
+        {
+            rc = sqlite_init_exec(db, "CREATE TABLE IF NOT EXISTS " SCHEMA_TABLE " (tbl TEXT PRIMARY KEY, fingerprint TEXT NOT NULL);");
+            SQLITE_SOURCE * find = job->sources;
+            while (find != NULL && rc == SQLITE_OK)
+            {
+                if (find->dbPath != NULL && strcmp(find->dbPath, job->dbPath) == 0)
+                {
+                    rc = sqlite_init_source(db, find);
+                }
+                find = find->p_next;
+            }
+            (void)sqlite_init_exec(db, (rc == SQLITE_OK) ? "COMMIT;" : "ROLLBACK;");
+        }
+    }
+    sqlite3_close(db);
+    return rc;
+}
+static bool sqlite_seen_path(SQLITE_SOURCE * sources, SQLITE_SOURCE * until)
+{
+    bool result = false;
+    while (sources != until)
+    {
+        if (sources->dbPath != NULL && strcmp(sources->dbPath, until->dbPath) == 0)
+        {
+            result = true;
+            break;
+        }
+        sources = sources->p_next;
+    }
+    return result;
+}
+/*Codes_SRS_SQLITE_99_023: [ `Sqlite_Start` shall create each table and trigger only when the stored fingerprint of its source differs, initializing distinct database files in parallel. ]*/
+static void sqlite_init_sources(SQLITE_SOURCE * sources, int incremental_vacuum)
+{
+    SQLITE_INIT_JOB * jobs = NULL;
+    size_t count = 0;
+    size_t i;
+    SQLITE_SOURCE * find;
+
+    for (find = sources; find != NULL; find = find->p_next)
+    {
+        if (find->dbPath != NULL && !sqlite_seen_path(sources, find))
+            count++;
+    }
+    if (count == 1)
+    {
+        SQLITE_INIT_JOB job = { NULL, sources, NULL, incremental_vacuum };
+        for (find = sources; find->dbPath == NULL; find = find->p_next);
+        job.dbPath = find->dbPath;
+        (void)sqlite_init_database(&job);
+    }
+    else if (count > 1)
+    {
+        jobs = (SQLITE_INIT_JOB *)malloc(count * sizeof(SQLITE_INIT_JOB));
+        if (jobs == NULL)
+        {
+            LogError("unable to allocate init jobs, initializing serially");
+        }
+        i = 0;
+        for (find = sources; find != NULL; find = find->p_next)
+        {
+            if (find->dbPath != NULL && !sqlite_seen_path(sources, find))
+            {
+                if (jobs == NULL)
+                {
+                    SQLITE_INIT_JOB job = { find->dbPath, sources, NULL, incremental_vacuum };
+                    (void)sqlite_init_database(&job);
+                }
+                else
+                {
+                    jobs[i].dbPath = find->dbPath;
+                    jobs[i].sources = sources;
+                    jobs[i].thread = NULL;
+                    jobs[i].incremental_vacuum = incremental_vacuum;
+                    i++;
+                }
+            }
+        }
+        /*start at most MAX_INIT_THREADS at a time, files that fail to get a thread are done here*/
+        for (i = 0; jobs != NULL && i < count; i += MAX_INIT_THREADS)
+        {
+            size_t j;
+            size_t last = (i + MAX_INIT_THREADS < count) ? i + MAX_INIT_THREADS : count;
+            for (j = i; j < last; j++)
+            {
+                if (ThreadAPI_Create(&(jobs[j].thread), sqlite_init_database, &jobs[j]) != THREADAPI_OK)
+                {
+                    jobs[j].thread = NULL;
+                    (void)sqlite_init_database(&jobs[j]);
+                }
+            }
+            for (j = i; j < last; j++)
+            {
+                int notUsed;
+                if (jobs[j].thread != NULL && ThreadAPI_Join(jobs[j].thread, &notUsed) != THREADAPI_OK)
+                {
+                    LogError("unable to join init thread for %s", jobs[j].dbPath);
+                }
+            }
+        }
+        free(jobs);
+    }
+}
+/*empty for main, or the quoted schema followed by a dot to put in front of a name*/
+static void sqlite_schema_prefix(const char * schema, char * prefix, size_t size)
+{
+    if (strcmp(schema, "main") == 0)
+    {
+        prefix[0] = '\0';
+    }
+    else
+    {
+        SNPRINTF_S(prefix, size, "\"%s\".", schema);
+    }
+}
+static void sqlite_rotate_partitions(sqlite3 * db, SQLITE_SOURCE * source, const char * schema)
+{
+    char prefix[BUFSIZE];
+    int rc;
+    sqlite_schema_prefix(schema, prefix, sizeof(prefix));
+    /*a savepoint works whether or not the sender left a transaction open*/
+    rc = sqlite_init_exec(db, "SAVEPOINT gw_partition;");
+    if (rc == SQLITE_OK)
+    {
+        rc = sqlite_partition_rotate(db, source, sqlite_partition_period(source), 0, prefix);
+        if (rc != SQLITE_OK)
+        {
+            (void)sqlite_init_exec(db, "ROLLBACK TO gw_partition;");
+        }
+        (void)sqlite_init_exec(db, "RELEASE gw_partition;");
+    }
+    if (rc != SQLITE_OK)
+    {
+        /*inserts keep going to the previous partition meanwhile*/
+        LogError("unable to rotate the partitions of %s, retrying in %d s", source->table, PARTITION_RETRY_SECONDS);
+        source->partitionRetry = (long long)time(NULL) + PARTITION_RETRY_SECONDS;
+    }
+}
+/*moves the inserts of partitioned sources in this database to a new partition when their interval has passed,
+  on the command connection, where the database is reached under schema*/
+static void sqlite_check_partitions(SQLITE_HANDLE_DATA * handleData, const char * database, const char * schema)
+{
+    SQLITE_SOURCE * source;
+    for (source = handleData->sources; source != NULL; source = source->p_next)
+    {
+        if (source->partitionInterval > 0 && source->dbPath != NULL && strcmp(source->dbPath, database) == 0 &&
+            source->partitionCurrent != sqlite_partition_period(source) && (long long)time(NULL) >= source->partitionRetry)
+        {
+            sqlite_rotate_partitions(handleData->db, source, schema);
+        }
+    }
+}
+/*the absolute form SQLite reports for the file of a schema, the path as given when it cannot be resolved*/
+static void sqlite_full_path(const char * path, char * full, size_t size)
+{
+#ifdef _MSC_VER
+    if (_fullpath(full, path, size) == NULL)
+    {
+        SNPRINTF_S(full, size, "%s", path);
+    }
+#else
+    char resolved[PATH_MAX];
+    SNPRINTF_S(full, size, "%s", (realpath(path, resolved) != NULL) ? resolved : path);
+#endif
+}
+/*opened is the file SQLite reports for a schema, NULL or empty when the schema is missing or in memory*/
+static bool sqlite_same_file(const char * opened, const char * path)
+{
+    char opened_full[PATH_MAX];
+    char path_full[PATH_MAX];
+    if (opened == NULL || opened[0] == '\0')
+        return false;
+    sqlite_full_path(opened, opened_full, sizeof(opened_full));
+    sqlite_full_path(path, path_full, sizeof(path_full));
+#ifdef _MSC_VER
+    return _stricmp(opened_full, path_full) == 0;
+#else
+    return strcmp(opened_full, path_full) == 0;
+#endif
+}
+/*Codes_SRS_SQLITE_99_032: [ If "attach" is configured, the connection shall attach every other configured database file under the id of its first source, and a command for an attached file shall run on the same connection against that schema. ]*/
+static void sqlite_attach_sources(SQLITE_HANDLE_DATA * handleData)
+{
+    SQLITE_SOURCE * source;
+    const char * main_file = sqlite3_db_filename(handleData->db, "main");
+    char sql[BUFSIZE];
+    size_t length;
+    const char * c;
+
+    for (source = handleData->sources; source != NULL; source = source->p_next)
+    {
+        if (source->dbPath != NULL && source->id != NULL && !sqlite_same_file(main_file, source->dbPath) &&
+            find_source_by_path(source->dbPath, handleData) == source)
+        {
+            SNPRINTF_S(sql, BUFSIZE, "ATTACH DATABASE '");
+            for (c = source->dbPath; *c != '\0' && (length = strlen(sql)) + 2 < BUFSIZE; c++)
+            {
+                /*quotes in the path are doubled*/
+                sql[length] = *c;
+                sql[length + 1] = (*c == '\'') ? '\'' : '\0';
+                sql[length + 2] = '\0';
+            }
+            length = strlen(sql);
+            SNPRINTF_S(sql + length, BUFSIZE - length, "' AS \"%s\";", source->id);
+            if (sqlite3_exec(handleData->db, sql, NULL, NULL, NULL) != SQLITE_OK)
+            {
+                /*past SQLITE_MAX_ATTACHED the file is opened on its own when a command needs it*/
+                LogError("unable to attach %s as %s: %s", source->dbPath, source->id, sqlite3_errmsg(handleData->db));
+            }
+            else if (handleData->memory.cacheSize > 0)
+            {
+                SNPRINTF_S(sql, BUFSIZE, "PRAGMA \"%s\".cache_size=-%d;", source->id, handleData->memory.cacheSize);
+                if (sqlite3_exec(handleData->db, sql, NULL, NULL, NULL) != SQLITE_OK)
+                {
+                    LogError("unable to set cache_size: %s", sqlite3_errmsg(handleData->db));
+                }
+            }
+        }
+    }
+}
+/*the schema the open connection reaches the file under, "main" or the id it is attached under, NULL when it has not got the file*/
+static const char * sqlite_schema_of(SQLITE_HANDLE_DATA * handleData, const char * database)
+{
+    SQLITE_SOURCE * source;
+    if (sqlite_same_file(sqlite3_db_filename(handleData->db, "main"), database))
+        return "main";
+    if (handleData->attach != 0)
+    {
+        source = find_source_by_path(database, handleData);
+        if (source != NULL && source->id != NULL && sqlite_same_file(sqlite3_db_filename(handleData->db, source->id), database))
+            return source->id;
+    }
+    return NULL;
+}
+/*returns the schema the database is reached under on the command connection, NULL when it cannot be opened*/
+static const char * sqlite_try_open_db(const char * database, SQLITE_HANDLE_DATA * handleData)
+{
+    const char * schema = NULL;
+    int rc;
+    if (handleData->db != NULL)
+    {
+        /*with attach every configured file stays on the one connection, only a file it has not got reopens it*/
+        schema = sqlite_schema_of(handleData, database);
+        if (schema == NULL)
+        {
+            sqlite_stmt_cache_clear(handleData);
+            sqlite3_close(handleData->db);
+            handleData->db = NULL;
+        }
+    }
+    if (handleData->db == NULL)
+    {
+        rc = sqlite3_open(database, &(handleData->db));
+        if (rc != 0)
+        {
+            LogError("Can't open database: %s", sqlite3_errmsg(handleData->db));
+        }
+        else
+        {
+            LogInfo("Opened database %s successfully", database);
+            sqlite3_progress_handler(handleData->db, PROGRESS_OPCODES, sqlite_progress, handleData);
+            if (handleData->memory.cacheSize > 0)
+            {
+                char sql_cache[BUFSIZE];
+                /*a negative cache_size is in KiB rather than pages*/
+                SNPRINTF_S(sql_cache, BUFSIZE, "PRAGMA cache_size=-%d;", handleData->memory.cacheSize);
+                if (sqlite3_exec(handleData->db, sql_cache, NULL, NULL, NULL) != SQLITE_OK)
+                {
+                    LogError("unable to set cache_size: %s", sqlite3_errmsg(handleData->db));
+                }
+            }
+            if (handleData->attach != 0)
+            {
+                sqlite_attach_sources(handleData);
+            }
+            schema = "main";
+        }
+    }
+    if (schema != NULL)
+    {
+        sqlite_check_partitions(handleData, database, schema);
+    }
+    return schema;
+}
+static SQLITE_SOURCE * find_source_by_table(SQLITE_HANDLE_DATA * handleData, const char * database, const char * table)
+{
+    SQLITE_SOURCE * find = handleData->sources;
+    while (find != NULL)
+    {
+        if (find->dbPath != NULL && find->table != NULL && strcmp(find->dbPath, database) == 0 && strcmp(find->table, table) == 0)
+            break;
+        find = find->p_next;
+    }
+    return find;
+}
+/*ranked rowids with snippets from the FTS5 index of a configured table*/
+static void sqlite_search(SQLITE_HANDLE_DATA * handleData, JSON_Object * obj, const char * database, SQLITE_SOURCE * match_source, SQLITE_REQUEST * request)
+{
+    const char * table = json_object_get_string(obj, "table");
+    const char * query = json_object_get_string(obj, "query");
+    const char * limit = json_object_get_string(obj, "limit");
+    /*only configured tables, so the name can go into the SQL text*/
+    SQLITE_SOURCE * source = (table == NULL) ? match_source : find_source_by_table(handleData, database, table);
+    const char * schema;
+    if (source == NULL || !sqlite_has_fulltext(source))
+    {
+        LogError("search needs a configured table with fullText columns");
+    }
+    else if (query == NULL)
+    {
+        LogError("search has no query");
+    }
+    else if ((schema = sqlite_try_open_db(database, handleData)) != NULL)
+    {
+        char sql[BUFSIZE];
+        char prefix[BUFSIZE];
+        JSON_Value * params = json_value_init_array();
+        if (params == NULL)
+        {
+            LogError("unable to create search params");
+        }
+        else
+        {
+            sqlite_schema_prefix(schema, prefix, sizeof(prefix));
+            SNPRINTF_S(sql, BUFSIZE, "SELECT rowid, rank, snippet(%s_fts, -1, '[', ']', '...', 16) AS snippet FROM %s%s_fts WHERE %s_fts MATCH ? ORDER BY rank LIMIT ?;",
+                source->table, prefix, source->table, source->table);
+            (void)json_array_append_string(json_value_get_array(params), query);
+            (void)json_array_append_number(json_value_get_array(params), (limit != NULL && atoi(limit) > 0) ? atoi(limit) : DEFAULT_SEARCH_LIMIT);
+            if (request->timeout == 0)
+            {
+                request->timeout = source->timeout;
+            }
+            sqlite_exec(handleData, sql, params, request->publish, request);
+            json_value_free(params);
+        }
+    }
+}
+static bool sqlite_has_column(SQLITE_SOURCE * source, const char * name)
+{
+    SQLITE_COLUMN * column;
+    for (column = source->columns; column != NULL; column = column->p_next)
+    {
+        if (column->name != NULL && strcmp(column->name, name) == 0)
+            return true;
+    }
+    return false;
+}
+static bool sqlite_parse_cursor(const char * cursor, double * rowid, char * value)
+{
+    char * end;
+    size_t i = 0;
+    int high;
+    int low;
+
+    *rowid = (double)strtoll(cursor, &end, 10);
+    if (end == cursor || *end != ':')
+        return false;
+    for (end++; end[0] != '\0'; end += 2)
+    {
+        high = hex_digit(end[0]);
+        low = hex_digit(end[1]);
+        if (high < 0 || low < 0 || i + 1 >= BUFSIZE)
+            return false;
+        value[i++] = (char)((high << 4) | low);
+    }
+    value[i] = '\0';
+    return true;
+}
+/*one page of a configured table ordered by a key column, seeking past the cursor instead of skipping an OFFSET*/
+static void sqlite_range(SQLITE_HANDLE_DATA * handleData, JSON_Object * obj, const char * database, SQLITE_SOURCE * match_source, SQLITE_REQUEST * request)
+{
+    const char * table = json_object_get_string(obj, "table");
+    const char * column = json_object_get_string(obj, "column");
+    const char * start = json_object_get_string(obj, "start");
+    const char * end = json_object_get_string(obj, "end");
+    const char * cursor = json_object_get_string(obj, "cursor");
+    const char * page_size = json_object_get_string(obj, "pageSize");
+    /*only configured tables and columns, so the names can go into the SQL text*/
+    SQLITE_SOURCE * source = (table == NULL) ? match_source : find_source_by_table(handleData, database, table);
+    SQLITE_PAGE page;
+    char cursor_value[BUFSIZE];
+    double cursor_rowid = 0;
+    const char * schema;
+
+    if (source == NULL || column == NULL || !sqlite_has_column(source, column))
+    {
+        LogError("range needs a configured table and column");
+    }
+    else if (source->partitionInterval > 0)
+    {
+        /*the keyset is (column, rowid), the partition view has no rowid*/
+        LogError("range is not supported on the partitioned table %s", source->table);
+    }
+    else if (cursor != NULL && !sqlite_parse_cursor(cursor, &cursor_rowid, cursor_value))
+    {
+        LogError("invalid range cursor");
+    }
+    else if ((schema = sqlite_try_open_db(database, handleData)) != NULL)
+    {
+        char sql[BUFSIZE];
+        char prefix[BUFSIZE];
+        size_t length;
+        JSON_Value * params = json_value_init_array();
+        if (params == NULL)
+        {
+            LogError("unable to create range params");
+        }
+        else
+        {
+            JSON_Array * param_array = json_value_get_array(params);
+            memset(&page, 0, sizeof(page));
+            page.column = column;
+            page.size = (page_size != NULL && atoi(page_size) > 0) ? atoi(page_size) : DEFAULT_PAGE_SIZE;
+
+            sqlite_schema_prefix(schema, prefix, sizeof(prefix));
+            SNPRINTF_S(sql, BUFSIZE, "SELECT rowid AS gw_rowid, * FROM %s%s WHERE 1", prefix, source->table);
+            if (start != NULL)
+            {
+                length = strlen(sql);
+                SNPRINTF_S(sql + length, BUFSIZE - length, " AND %s >= ?", column);
+                (void)json_array_append_string(param_array, start);
+            }
+            if (end != NULL)
+            {
+                length = strlen(sql);
+                SNPRINTF_S(sql + length, BUFSIZE - length, " AND %s < ?", column);
+                (void)json_array_append_string(param_array, end);
+            }
+            if (cursor != NULL)
+            {
+                /*rowid breaks ties between rows with the same key*/
+                length = strlen(sql);
+                SNPRINTF_S(sql + length, BUFSIZE - length, " AND (%s, rowid) > (?, ?)", column);
+                (void)json_array_append_string(param_array, cursor_value);
+                (void)json_array_append_number(param_array, cursor_rowid);
+            }
+            length = strlen(sql);
+            SNPRINTF_S(sql + length, BUFSIZE - length, " ORDER BY %s, rowid LIMIT ?;", column);
+            (void)json_array_append_number(param_array, page.size);
+
+            if (request->timeout == 0)
+            {
+                request->timeout = source->timeout;
+            }
+            currentPage = &page;
+            sqlite_exec(handleData, sql, params, request->publish, request);
+            currentPage = NULL;
+            json_value_free(params);
+        }
+    }
+}
+typedef enum SQLITE_AGGREGATE_FUNCTION_TAG
+{
+    AGGREGATE_MIN = 1,
+    AGGREGATE_MAX = 2,
+    AGGREGATE_AVG = 4,
+    AGGREGATE_SUM = 8,
+    AGGREGATE_COUNT = 16,
+    AGGREGATE_FIRST = 32,
+    AGGREGATE_LAST = 64
+} SQLITE_AGGREGATE_FUNCTION;
+
+static const struct
+{
+    const char * name;
+    int function;
+} aggregate_functions[] =
+{
+    { "min", AGGREGATE_MIN }, { "max", AGGREGATE_MAX }, { "avg", AGGREGATE_AVG }, { "sum", AGGREGATE_SUM },
+    { "count", AGGREGATE_COUNT }, { "first", AGGREGATE_FIRST }, { "last", AGGREGATE_LAST }
+};
+
+typedef struct SQLITE_AGGREGATE_TAG
+{
+    const char * column;
+    size_t count; //non NULL values in the bucket
+    double min;
+    double max;
+    double sum;
+    double first;
+    double last;
+}SQLITE_AGGREGATE;
+
+/*splits a comma separated list in place, NULL entries past the end*/
+static int sqlite_split_list(char * list, char ** items, int max_items)
+{
+    int count = 0;
+    char * item = list;
+    while (item != NULL && count <= max_items)
+    {
+        char * next = strchr(item, ',');
+        char * end;
+        if (next != NULL)
+            *next++ = '\0';
+        item += strspn(item, " \t");
+        end = item + strlen(item);
+        while (end > item && (end[-1] == ' ' || end[-1] == '\t'))
+            *--end = '\0';
+        if (*item != '\0')
+        {
+            if (count == max_items)
+                return -1;
+            items[count++] = item;
+        }
+        item = next;
+    }
+    return count;
+}
+static int sqlite_parse_functions(char * list)
+{
+    char * names[sizeof(aggregate_functions) / sizeof(aggregate_functions[0])];
+    int count = sqlite_split_list(list, names, sizeof(names) / sizeof(names[0]));
+    int functions = 0;
+    int i;
+    size_t j;
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < sizeof(aggregate_functions) / sizeof(aggregate_functions[0]); j++)
+        {
+            if (strcmp(names[i], aggregate_functions[j].name) == 0)
+                break;
+        }
+        if (j == sizeof(aggregate_functions) / sizeof(aggregate_functions[0]))
+        {
+            LogError("unknown aggregate function %s", names[i]);
+            return 0;
+        }
+        functions |= aggregate_functions[j].function;
+    }
+    return (count < 0) ? 0 : functions;
+}
+static void sqlite_emit_bucket(JSON_Object * result, int bucket_idx, sqlite3_int64 start, size_t rows, SQLITE_AGGREGATE * aggregates, int column_count, int functions)
+{
+    char key[BUFSIZE];
+    int i;
+    size_t j;
+
+    SNPRINTF_S(key, BUFSIZE, "buckets[%d].start", bucket_idx);
+    json_object_dotset_number(result, key, (double)start);
+    SNPRINTF_S(key, BUFSIZE, "buckets[%d].rows", bucket_idx);
+    json_object_dotset_number(result, key, (double)rows);
+    for (i = 0; i < column_count; i++)
+    {
+        SQLITE_AGGREGATE * aggregate = &(aggregates[i]);
+        for (j = 0; j < sizeof(aggregate_functions) / sizeof(aggregate_functions[0]); j++)
+        {
+            int function = aggregate_functions[j].function;
+            double value;
+            if ((functions & function) == 0 || (aggregate->count == 0 && function != AGGREGATE_COUNT))
+                continue;
+            switch (function)
+            {
+            case AGGREGATE_MIN: value = aggregate->min; break;
+            case AGGREGATE_MAX: value = aggregate->max; break;
+            case AGGREGATE_AVG: value = aggregate->sum / (double)aggregate->count; break;
+            case AGGREGATE_SUM: value = aggregate->sum; break;
+            case AGGREGATE_COUNT: value = (double)aggregate->count; break;
+            case AGGREGATE_FIRST: value = aggregate->first; break;
+            default: value = aggregate->last; break;
+            }
+            SNPRINTF_S(key, BUFSIZE, "buckets[%d].%s.%s", bucket_idx, aggregate->column, aggregate_functions[j].name);
+            json_object_dotset_number(result, key, value);
+        }
+    }
+}
+/*steps through the range in key order once, folding each row into the aggregates of its bucket*/
+static int sqlite_aggregate_rows(sqlite3_stmt * stmt, JSON_Object * result, SQLITE_AGGREGATE * aggregates, int column_count, int functions, int * bucket_count)
+{
+    sqlite3_int64 current = 0;
+    size_t rows = 0;
+    int rc;
+    int i;
+
+    *bucket_count = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        sqlite3_int64 bucket = sqlite3_column_int64(stmt, 0);
+        if (rows == 0 || bucket != current)
+        {
+            if (rows > 0)
+            {
+                sqlite_emit_bucket(result, (*bucket_count)++, current, rows, aggregates, column_count, functions);
+            }
+            for (i = 0; i < column_count; i++)
+            {
+                aggregates[i].count = 0;
+                aggregates[i].sum = 0;
+            }
+            current = bucket;
+            rows = 0;
+        }
+        rows++;
+        for (i = 0; i < column_count; i++)
+        {
+            SQLITE_AGGREGATE * aggregate = &(aggregates[i]);
+            double value;
+            if (sqlite3_column_type(stmt, i + 1) == SQLITE_NULL)
+                continue;
+            value = sqlite3_column_double(stmt, i + 1);
+            if (aggregate->count == 0)
+            {
+                aggregate->min = value;
+                aggregate->max = value;
+                aggregate->first = value;
+            }
+            else
+            {
+                if (value < aggregate->min)
+                    aggregate->min = value;
+                if (value > aggregate->max)
+                    aggregate->max = value;
+            }
+            aggregate->last = value;
+            aggregate->sum += value;
+            aggregate->count++;
+        }
+    }
+    if (rc == SQLITE_DONE)
+    {
+        if (rows > 0)
+        {
+            sqlite_emit_bucket(result, (*bucket_count)++, current, rows, aggregates, column_count, functions);
+        }
+        rc = SQLITE_OK;
+    }
+    return rc;
+}
+static void sqlite_run_aggregate(SQLITE_HANDLE_DATA * handle, const char * sql, const JSON_Value * params, SQLITE_AGGREGATE * aggregates, int column_count, int functions, int publish, const SQLITE_REQUEST * request)
+{
+    JSON_Value * result_value = json_value_init_object();
+    JSON_Object * result = json_value_get_object(result_value);
+    char error[BUFSIZE] = { 0 };
+    int bucket_count = 0;
+    int rc;
+
+    if (result == NULL)
+    {
+        LogError("unable to create aggregate result");
+    }
+    else
+    {
+        sqlite3_stmt * stmt = sqlite_stmt_get(handle, sql, error);
+        if (stmt == NULL)
+        {
+            rc = SQLITE_ERROR;
+        }
+        else
+        {
+            sqlite_begin_request(handle, request);
+            rc = sqlite_bind_params(stmt, params, error);
+            if (rc == SQLITE_OK)
+            {
+                rc = sqlite_aggregate_rows(stmt, result, aggregates, column_count, functions, &bucket_count);
+                if (rc != SQLITE_OK)
+                    SNPRINTF_S(error, BUFSIZE, "%s", sqlite3_errmsg(handle->db));
+            }
+            sqlite_end_request(handle, request);
+            (void)sqlite3_reset(stmt);
+            (void)sqlite3_clear_bindings(stmt);
+            if (!sqlite_stmt_is_cached(handle, stmt))
+            {
+                (void)sqlite3_finalize(stmt);
+            }
+        }
+        if (rc != SQLITE_OK)
+        {
+            /*a partial result would read as complete buckets*/
+            json_value_free(result_value);
+            result_value = json_value_init_object();
+            result = json_value_get_object(result_value);
+            sqlite_format_error(handle, rc, request, error);
+            LogError("SQL error: %s", errorText);
+            json_object_set_string(result, "error", errorText);
+        }
+        else
+        {
+            json_object_set_number(result, "bucketCount", (double)bucket_count);
+        }
+        if (request->request_id != NULL)
+        {
+            json_object_set_string(result, "requestId", request->request_id);
+        }
+        if (publish == 1)
+        {
+            sqlite_publish_json(handle, result_value);
+        }
+        sqlite_check_memory_budget(handle);
+    }
+    json_value_free(result_value);
+}
+static bool sqlite_has_columns(SQLITE_SOURCE * source, char ** names, int count)
+{
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        if (!sqlite_has_column(source, names[i]))
+        {
+            LogError("column %s is not configured", names[i]);
+            return false;
+        }
+    }
+    return true;
+}
+/*bucketed statistics of configured columns computed on the gateway in one pass over the range*/
+static void sqlite_aggregate(SQLITE_HANDLE_DATA * handleData, JSON_Object * obj, const char * database, SQLITE_SOURCE * match_source, SQLITE_REQUEST * request)
+{
+    const char * table = json_object_get_string(obj, "table");
+    const char * key = json_object_get_string(obj, "column");
+    const char * columns = json_object_get_string(obj, "columns");
+    const char * functions_text = json_object_get_string(obj, "functions");
+    const char * bucket_text = json_object_get_string(obj, "bucket");
+    const char * start = json_object_get_string(obj, "start");
+    const char * end = json_object_get_string(obj, "end");
+    /*only configured tables and columns, so the names can go into the SQL text*/
+    SQLITE_SOURCE * source = (table == NULL) ? match_source : find_source_by_table(handleData, database, table);
+    SQLITE_AGGREGATE aggregates[MAX_AGGREGATE_COLUMNS];
+    char * names[MAX_AGGREGATE_COLUMNS];
+    char column_list[BUFSIZE];
+    char function_list[BUFSIZE];
+    int bucket = (bucket_text != NULL) ? atoi(bucket_text) : 0;
+    int column_count;
+    int functions;
+    const char * schema;
+
+    SNPRINTF_S(column_list, BUFSIZE, "%s", (columns != NULL) ? columns : "");
+    SNPRINTF_S(function_list, BUFSIZE, "%s", (functions_text != NULL) ? functions_text : "min,max,avg,last");
+    if (source == NULL || key == NULL || !sqlite_has_column(source, key))
+    {
+        LogError("aggregate needs a configured table and key column");
+    }
+    else if (bucket <= 0)
+    {
+        LogError("aggregate needs a positive bucket");
+    }
+    else if ((column_count = sqlite_split_list(column_list, names, MAX_AGGREGATE_COLUMNS)) <= 0 || !sqlite_has_columns(source, names, column_count))
+    {
+        LogError("aggregate needs up to %d configured columns", MAX_AGGREGATE_COLUMNS);
+    }
+    else if ((functions = sqlite_parse_functions(function_list)) == 0)
+    {
+        LogError("aggregate needs functions among min, max, avg, sum, count, first and last");
+    }
+    else if ((schema = sqlite_try_open_db(database, handleData)) != NULL)
+    {
+        char sql[BUFSIZE];
+        char prefix[BUFSIZE];
+        char quotient[BUFSIZE];
+        size_t length;
+        int i;
+        JSON_Value * params = json_value_init_array();
+        if (params == NULL)
+        {
+            LogError("unable to create aggregate params");
+        }
+        else
+        {
+            /*numeric keys are bucketed as they are, text keys as date and time in seconds since 1970,
+              floor(x) is CAST(x AS INTEGER) less one below zero, CAST alone truncates toward zero and would put -1 into bucket 0*/
+            SNPRINTF_S(quotient, BUFSIZE, "CAST(CASE WHEN typeof(%s) IN ('integer', 'real') THEN %s ELSE strftime('%%s', %s) END AS REAL) / %d",
+                key, key, key, bucket);
+            SNPRINTF_S(sql, BUFSIZE, "SELECT (CAST(%s AS INTEGER) - (%s < CAST(%s AS INTEGER))) * %d AS gw_bucket",
+                quotient, quotient, quotient, bucket);
+            for (i = 0; i < column_count; i++)
+            {
+                memset(&(aggregates[i]), 0, sizeof(SQLITE_AGGREGATE));
+                aggregates[i].column = names[i];
+                length = strlen(sql);
+                SNPRINTF_S(sql + length, BUFSIZE - length, ", %s", names[i]);
+            }
+            sqlite_schema_prefix(schema, prefix, sizeof(prefix));
+            length = strlen(sql);
+            SNPRINTF_S(sql + length, BUFSIZE - length, " FROM %s%s WHERE %s IS NOT NULL", prefix, source->table, key);
+            if (start != NULL)
+            {
+                length = strlen(sql);
+                SNPRINTF_S(sql + length, BUFSIZE - length, " AND %s >= ?", key);
+                (void)json_array_append_string(json_value_get_array(params), start);
+            }
+            if (end != NULL)
+            {
+                length = strlen(sql);
+                SNPRINTF_S(sql + length, BUFSIZE - length, " AND %s < ?", key);
+                (void)json_array_append_string(json_value_get_array(params), end);
+            }
+            /*rowid keeps first and last stable among equal keys, the partition view has none*/
+            length = strlen(sql);
+            SNPRINTF_S(sql + length, BUFSIZE - length, " ORDER BY %s%s;", key, (source->partitionInterval > 0) ? "" : ", rowid");
+
+            if (request->timeout == 0)
+            {
+                request->timeout = source->timeout;
+            }
+            sqlite_run_aggregate(handleData, sql, params, aggregates, column_count, functions, request->publish, request);
+            json_value_free(params);
+        }
+    }
+}
+static void sqlite_handle_command(SQLITE_HANDLE_DATA * handleData, JSON_Object * obj, SQLITE_SOURCE * match_source)
+{
+    SQLITE_REQUEST request;
+    /*match_source is NULL for commands from IoTHub, which name their own database and get the result published*/
+    const char * database = (match_source != NULL) ? match_source->dbPath : json_object_get_string(obj, "dbPath");
+    const char * sqlcmd = json_object_get_string(obj, "sqlCommand");
+    const char * request_type = sqlite_parse_request(obj, &request);
+    if (match_source != NULL)
+    {
+        /*commands from other modules are mostly ingest, only those that ask get an answer*/
+        request.local = 1;
+        request.publish = (request.reply != NULL && strcmp(request.reply, "result") == 0) ? 1 : 0;
+    }
+    handleData->current_request = &request;
+    if (request_type != NULL && strcmp(request_type, "cancel") == 0 && !handleData->scheduler)
+    {
+        /*Codes_SRS_SQLITE_99_047: [ Without the worker thread, `Sqlite_Receive` shall reject a cancel request and publish an error with its "requestId" unless it asked for no reply. ]*/
+        /*the receiving thread runs every command itself, a cancel only gets here once the request it names is done*/
+        LogError("cancel needs the command worker, request %s is not cancelled", (request.request_id != NULL) ? request.request_id : "");
+        if (request.publish)
+        {
+            sqlite_reply_error(handleData, "cancel needs the command worker, configure lanes", match_source, &request);
+        }
+    }
+    else if (request_type != NULL && strcmp(request_type, "cancel") == 0)
+    {
+        sqlite_cancel(handleData, request.request_id);
+    }
+    else if (request_type != NULL && strcmp(request_type, "memory") == 0)
+    {
+        /*Codes_SRS_SQLITE_99_049: [ If the content of messageHandle has "requestType" set to "memory", `Sqlite_Receive` shall publish the SQLite heap use and the configured limits, and the gballoc totals only when the module is built to measure memory and gballoc was initialized. ]*/
+        sqlite_report_memory(handleData, &request, request.publish);
+    }
+    else if (request_type != NULL && strcmp(request_type, "slowlog") == 0)
+    {
+        /*Codes_SRS_SQLITE_99_028: [ If the content of messageHandle has "requestType" set to "slowlog", `Sqlite_Receive` shall publish the sampled slow commands, newest first. ]*/
+        sqlite_report_slow_log(handleData, &request, request.publish);
+    }
+    else if (request_type != NULL && strcmp(request_type, "trace") == 0)
+    {
+        sqlite_report_trace(handleData, &request, request.publish);
+    }
+    else if (request_type != NULL && strcmp(request_type, "admission") == 0)
+    {
+        sqlite_report_admission(handleData, &request, request.publish);
+    }
+    else if (database == NULL)
+    {
+        LogError("database is NULL");
+    }
+    else if (request_type != NULL && strcmp(request_type, "search") == 0)
+    {
+        /*Codes_SRS_SQLITE_99_026: [ If the content of messageHandle has "requestType" set to "search", `Sqlite_Receive` shall publish the rowids, ranks and snippets matching "query" in the full text index of the table. ]*/
+        sqlite_search(handleData, obj, database, match_source, &request);
+    }
+    else if (request_type != NULL && strcmp(request_type, "range") == 0)
+    {
+        /*Codes_SRS_SQLITE_99_029: [ If the content of messageHandle has "requestType" set to "range", `Sqlite_Receive` shall publish one page of the table ordered by "column" after "cursor", with the cursor of the next page when the page is full. ]*/
+        sqlite_range(handleData, obj, database, match_source, &request);
+    }
+    else if (request_type != NULL && strcmp(request_type, "aggregate") == 0)
+    {
+        /*Codes_SRS_SQLITE_99_030: [ If the content of messageHandle has "requestType" set to "aggregate", `Sqlite_Receive` shall publish the requested functions of "columns" per "bucket" of the key "column", computed in one pass over the range. ]*/
+        sqlite_aggregate(handleData, obj, database, match_source, &request);
+    }
+    else if (request_type != NULL && strcmp(request_type, "batch") == 0)
+    {
+        /*Codes_SRS_SQLITE_99_025: [ If the content of messageHandle has "requestType" set to "batch", `Sqlite_Receive` shall execute every entry of "statements" in one transaction and publish one combined result. ]*/
+        JSON_Array * statements = json_object_get_array(obj, "statements");
+        const char * atomic = json_object_get_string(obj, "atomic");
+        if (statements == NULL)
+        {
+            LogError("batch has no statements");
+        }
+        else
+        {
+            if (request.timeout == 0)
+            {
+                SQLITE_SOURCE * timeout_source = (match_source != NULL) ? match_source : find_source_by_path(database, handleData);
+                request.timeout = (timeout_source != NULL) ? timeout_source->timeout : 0;
+            }
+            if (sqlite_try_open_db(database, handleData))
+            {
+                sqlite_exec_batch(handleData, statements, (atomic == NULL || atoi(atomic) != 0) ? 1 : 0, request.publish, &request);
+            }
+        }
+    }
+    else if (sqlcmd == NULL)
+    {
+        LogError("sqlcmd is NULL");
+    }
+    else
+    {
+        /*Codes_SRS_SQLITE_99_024: [ If the content of messageHandle has a "params" array or object, `Sqlite_Receive` shall bind it to the single statement in "sqlCommand" by position or by name, reusing the prepared statement. ]*/
+        JSON_Value * params = json_object_get_value(obj, "params");
+        if (request.timeout == 0)
+        {
+            SQLITE_SOURCE * timeout_source = (match_source != NULL) ? match_source : find_source_by_path(database, handleData);
+            request.timeout = (timeout_source != NULL) ? timeout_source->timeout : 0;
+        }
+        if (sqlite_try_open_db(database, handleData))
+        {
+            if (params != NULL && json_value_get_type(params) != JSONArray && json_value_get_type(params) != JSONObject)
+            {
+                LogError("params must be an array or an object");
+            }
+            else
+            {
+                sqlite_exec(handleData, (char *)sqlcmd, params, request.publish, &request);
+            }
+        }
+    }
+    handleData->current_request = NULL;
+}
+static void sqlite_execute(SQLITE_HANDLE_DATA * handleData, JSON_Object * obj, SQLITE_SOURCE * match_source, SQLITE_TRACE * trace)
+{
+    /*only commands of other modules are watched, their producers are the ones that can slow down*/
+    int watched = (match_source != NULL && (handleData->backpressure.highBacklog > 0 || handleData->backpressure.highLatency > 0));
+    tickcounter_ms_t started = 0;
+    int timed = (watched && handleData->backpressure.highLatency > 0 && tickcounter_get_current_ms(handleData->tick_counter, &started) == 0);
+    if (handleData->trace)
+    {
+        trace->stamps[SQLITE_TRACE_DEQUEUED] = sqlite_trace_now();
+        handleData->current_trace = trace;
+    }
+    sqlite_handle_command(handleData, obj, match_source);
+    if (handleData->trace)
+    {
+        handleData->current_trace = NULL;
+        sqlite_trace_record(handleData, trace);
+    }
+    if (watched)
+    {
+        tickcounter_ms_t now;
+        double elapsed = (timed && tickcounter_get_current_ms(handleData->tick_counter, &now) == 0) ? (double)(now - started) : -1;
+        sqlite_check_backpressure(handleData, match_source, elapsed);
+    }
+}
+/*Codes_SRS_SQLITE_99_042: [ If the lane of a command already holds its capacity, `Sqlite_Receive` shall refuse the command and publish an error with its "requestId" unless it asked for no reply. ]*/
+static void sqlite_refuse(SQLITE_HANDLE_DATA * handleData, SQLITE_LANE_ID lane_id, const SQLITE_SOURCE * match_source, const SQLITE_REQUEST * request)
+{
+    char text[BUFSIZE];
+    SNPRINTF_S(text, BUFSIZE, "lane %s is full", lane_names[lane_id]);
+    sqlite_reply_error(handleData, text, match_source, request);
+}
+static SQLITE_LANE_ID sqlite_classify(CONSTMAP_HANDLE properties, SQLITE_SOURCE * match_source)
+{
+    /*local ingest is time critical, commands from IoTHub are interactive unless the sender says otherwise*/
+    SQLITE_LANE_ID lane = (match_source != NULL) ? SQLITE_LANE_INGEST : SQLITE_LANE_INTERACTIVE;
+    const char * priority = ConstMap_GetValue(properties, "priority");
+    if (priority != NULL)
+    {
+        if (strcmp(priority, "ingest") == 0)
+            lane = SQLITE_LANE_INGEST;
+        else if (strcmp(priority, "interactive") == 0)
+            lane = SQLITE_LANE_INTERACTIVE;
+        else if (strcmp(priority, "bulk") == 0)
+            lane = SQLITE_LANE_BULK;
+        else
+            LogError("unknown priority %s, using default lane", priority);
+    }
+    return lane;
+}
+static void sqlite_enqueue(SQLITE_HANDLE_DATA * handleData, JSON_Value * json, SQLITE_SOURCE * match_source, CONSTMAP_HANDLE properties, const SQLITE_TRACE * trace)
+{
+    JSON_Object * obj = json_value_get_object(json);
+    if (obj == NULL)
+    {
+        LogError("json_value_get_obj failed");
+        json_value_free(json);
+    }
+    else
+    {
+        SQLITE_REQUEST request;
+        const char * request_type = sqlite_parse_request(obj, &request);
+        if (request_type != NULL && strcmp(request_type, "cancel") == 0)
+        {
+            /*cancellation must not wait behind the request it cancels*/
+            sqlite_cancel(handleData, request.request_id);
+            json_value_free(json);
+        }
+        else
+        {
+            SQLITE_WORK_ITEM * item = malloc(sizeof(SQLITE_WORK_ITEM));
+            if (item == NULL)
+            {
+                LogError("unable to allocate work item");
+                json_value_free(json);
+            }
+            else
+            {
+                SQLITE_LANE_ID lane_id = sqlite_classify(properties, match_source);
+                SQLITE_LANE * lane = &(handleData->lanes[lane_id]);
+                item->p_next = NULL;
+                item->json = json;
+                item->source = match_source;
+                item->request_id = request.request_id;
+                item->enqueued = 0;
+                item->trace = *trace;
+                (void)tickcounter_get_current_ms(handleData->tick_counter, &(item->enqueued));
+                if (Lock(handleData->queue_lock) != LOCK_OK)
+                {
+                    LogError("unable to lock work queue");
+                    json_value_free(json);
+                    free(item);
+                }
+                else if (lane->depth >= lane->capacity)
+                {
+                    /*the newest command is turned away, the ones already waiting keep their place*/
+                    lane->refused++;
+                    (void)Unlock(handleData->queue_lock);
+                    LogError("lane %s is full, command refused", lane_names[lane_id]);
+                    if (request.publish)
+                    {
+                        sqlite_refuse(handleData, lane_id, match_source, &request);
+                    }
+                    json_value_free(json);
+                    free(item);
+                }
+                else
+                {
+                    if (lane->head == NULL)
+                    {
+                        /*an idle lane does not bank credit while it has nothing to run*/
+                        if (lane->virtual_time < handleData->virtual_clock)
+                            lane->virtual_time = handleData->virtual_clock;
+                        lane->head = item;
+                    }
+                    else
+                    {
+                        lane->tail->p_next = item;
+                    }
+                    lane->tail = item;
+                    lane->depth++;
+                    if (match_source != NULL)
+                        match_source->queued++;
+                    (void)Condition_Post(handleData->queue_cond);
+                    (void)Unlock(handleData->queue_lock);
+                    if (match_source != NULL && handleData->backpressure.highBacklog > 0)
+                    {
+                        sqlite_check_backpressure(handleData, match_source, -1);
+                    }
+                }
+            }
+        }
+    }
+}
+static SQLITE_WORK_ITEM * sqlite_dequeue(SQLITE_HANDLE_DATA * handleData)
+{
+    SQLITE_WORK_ITEM * item = NULL;
+    tickcounter_ms_t now = 0;
+    int chosen = -1;
+    int lane_id;
+
+    (void)tickcounter_get_current_ms(handleData->tick_counter, &now);
+    if (Lock(handleData->queue_lock) == LOCK_OK)
+    {
+        /*a lane whose oldest request is past its latency target goes first, the most overdue one wins*/
+        tickcounter_ms_t worst_overdue = 0;
+        for (lane_id = 0; lane_id < SQLITE_LANE_COUNT; lane_id++)
+        {
+            SQLITE_LANE * lane = &(handleData->lanes[lane_id]);
+            if (lane->head != NULL && lane->latency_target > 0 && now - lane->head->enqueued > (tickcounter_ms_t)lane->latency_target)
+            {
+                tickcounter_ms_t overdue = now - lane->head->enqueued - lane->latency_target;
+                if (chosen < 0 || overdue > worst_overdue)
+                {
+                    chosen = lane_id;
+                    worst_overdue = overdue;
+                }
+            }
+        }
+        /*otherwise weighted fair scheduling, the backlogged lane with the smallest virtual time runs next*/
+        if (chosen < 0)
+        {
+            for (lane_id = 0; lane_id < SQLITE_LANE_COUNT; lane_id++)
+            {
+                SQLITE_LANE * lane = &(handleData->lanes[lane_id]);
+                if (lane->head != NULL && (chosen < 0 || lane->virtual_time < handleData->lanes[chosen].virtual_time))
+                {
+                    chosen = lane_id;
+                }
+            }
+        }
+        if (chosen >= 0)
+        {
+            SQLITE_LANE * lane = &(handleData->lanes[chosen]);
+            item = lane->head;
+            lane->head = item->p_next;
+            if (lane->head == NULL)
+                lane->tail = NULL;
+            lane->depth--;
+            if (item->source != NULL)
+                item->source->queued--;
+            if (lane->latency_target > 0 && now - item->enqueued > (tickcounter_ms_t)lane->latency_target)
+                lane->target_misses++;
+            handleData->virtual_clock = lane->virtual_time;
+            lane->virtual_time += LANE_STRIDE / lane->weight;
+        }
+        (void)Unlock(handleData->queue_lock);
+    }
+    return item;
+}
+static void sqlite_free_queue(SQLITE_HANDLE_DATA * handleData)
+{
+    int lane_id;
+    for (lane_id = 0; lane_id < SQLITE_LANE_COUNT; lane_id++)
+    {
+        SQLITE_LANE * lane = &(handleData->lanes[lane_id]);
+        while (lane->head != NULL)
+        {
+            SQLITE_WORK_ITEM * item = lane->head;
+            lane->head = item->p_next;
+            if (item->source != NULL)
+                item->source->queued--;
+            json_value_free(item->json);
+            free(item);
+        }
+        lane->tail = NULL;
+        lane->depth = 0;
+    }
+}
+static void sqlite_configure_maintenance(SQLITE_HANDLE_DATA * handle, const SQLITE_CONFIG * config)
+{
+    handle->maintenance = config->maintenance;
+    if (handle->maintenance.idleTime <= 0)
+        handle->maintenance.idleTime = DEFAULT_MAINTENANCE_IDLE_MS;
+    if (handle->maintenance.sliceBudget <= 0)
+        handle->maintenance.sliceBudget = DEFAULT_MAINTENANCE_SLICE_MS;
+    if (handle->maintenance.vacuumPages <= 0)
+        handle->maintenance.vacuumPages = DEFAULT_VACUUM_PAGES;
+    if (handle->maintenance.analysisLimit <= 0)
+        handle->maintenance.analysisLimit = DEFAULT_ANALYSIS_LIMIT;
+}
+static void sqlite_configure_backpressure(SQLITE_HANDLE_DATA * handle, const SQLITE_CONFIG * config)
+{
+    handle->backpressure = config->backpressure;
+    if (handle->backpressure.lowBacklog <= 0 || handle->backpressure.lowBacklog > handle->backpressure.highBacklog)
+        handle->backpressure.lowBacklog = handle->backpressure.highBacklog / 2;
+    if (handle->backpressure.lowLatency <= 0 || handle->backpressure.lowLatency > handle->backpressure.highLatency)
+        handle->backpressure.lowLatency = handle->backpressure.highLatency / 2;
+}
+/*moves maintenance to the next database file, or ends the pass after the last one*/
+static void sqlite_maintenance_next_file(SQLITE_HANDLE_DATA * handleData, tickcounter_ms_t now)
+{
+    SQLITE_SOURCE * find = handleData->maintenance_file->p_next;
+    if (handleData->maintenance_db != NULL)
+    {
+        sqlite3_close(handleData->maintenance_db);
+        handleData->maintenance_db = NULL;
+    }
+    while (find != NULL && (find->dbPath == NULL || sqlite_seen_path(handleData->sources, find)))
+        find = find->p_next;
+    handleData->maintenance_file = find;
+    handleData->maintenance_table = find;
+    handleData->maintenance_step = SQLITE_MAINTENANCE_VACUUM;
+    if (find == NULL)
+    {
+        LogInfo("maintenance pass done");
+        handleData->maintenance_due = now + (tickcounter_ms_t)handleData->maintenance.interval * 1000;
+    }
+}
+/*runs one maintenance statement on the current file, SQLITE_DONE once the file has been optimized*/
+static int sqlite_maintenance_step(SQLITE_HANDLE_DATA * handleData, SQLITE_SOURCE * file)
+{
+    char sql[BUFSIZE];
+    char mode[BUFSIZE] = { 0 };
+    char free_pages[BUFSIZE] = { 0 };
+    SQLITE_SOURCE * table;
+    int rc = SQLITE_OK;
+
+    switch (handleData->maintenance_step)
+    {
+    case SQLITE_MAINTENANCE_VACUUM:
+        rc = sqlite3_exec(handleData->maintenance_db, "PRAGMA auto_vacuum;", fingerprint_callback, mode, NULL);
+        if (rc == SQLITE_OK && atoi(mode) == 2)
+        {
+            rc = sqlite3_exec(handleData->maintenance_db, "PRAGMA freelist_count;", fingerprint_callback, free_pages, NULL);
+        }
+        if (rc == SQLITE_OK && atoi(mode) == 2 && atoi(free_pages) > 0)
+        {
+            /*a few pages at a time, each step is its own short write transaction*/
+            SNPRINTF_S(sql, BUFSIZE, "PRAGMA incremental_vacuum(%d);", handleData->maintenance.vacuumPages);
+            rc = sqlite_init_exec(handleData->maintenance_db, sql);
+        }
+        else if (rc == SQLITE_OK)
+        {
+            handleData->maintenance_step = SQLITE_MAINTENANCE_ANALYZE;
+        }
+        break;
+    case SQLITE_MAINTENANCE_ANALYZE:
+        table = handleData->maintenance_table;
+        while (table != NULL && (table->dbPath == NULL || strcmp(table->dbPath, file->dbPath) != 0))
+            table = table->p_next;
+        if (table == NULL)
+        {
+            handleData->maintenance_step = SQLITE_MAINTENANCE_OPTIMIZE;
+        }
+        else
+        {
+            handleData->maintenance_table = table->p_next;
+            SNPRINTF_S(sql, BUFSIZE, "PRAGMA analysis_limit=%d;", handleData->maintenance.analysisLimit);
+            rc = sqlite_init_exec(handleData->maintenance_db, sql);
+            if (rc == SQLITE_OK && table->partitionInterval > 0)
+            {
+                /*the older partitions were analyzed while they were current*/
+                SNPRINTF_S(sql, BUFSIZE, "ANALYZE %s_p%lld;", table->table, table->partitionCurrent);
+                rc = sqlite_init_exec(handleData->maintenance_db, sql);
+            }
+            else if (rc == SQLITE_OK)
+            {
+                SNPRINTF_S(sql, BUFSIZE, "ANALYZE %s;", table->table);
+                rc = sqlite_init_exec(handleData->maintenance_db, sql);
+            }
+        }
+        break;
+    default:
+        rc = sqlite_init_exec(handleData->maintenance_db, "PRAGMA optimize;");
+        if (rc == SQLITE_OK)
+            rc = SQLITE_DONE;
+        break;
+    }
+    return rc;
+}
+/*Codes_SRS_SQLITE_99_033: [ If "maintenance" is configured, the worker shall run incremental vacuum, ANALYZE and PRAGMA optimize on every database file in slices of at most sliceBudget ms once the work queues have been empty for idleTime ms. ]*/
+static void sqlite_maintenance_slice(SQLITE_HANDLE_DATA * handleData)
+{
+    tickcounter_ms_t now = 0;
+    tickcounter_ms_t slice_end;
+    SQLITE_SOURCE * file;
+    int rc = SQLITE_OK;
+
+    if (tickcounter_get_current_ms(handleData->tick_counter, &now) != 0 ||
+        now - handleData->last_busy < (tickcounter_ms_t)handleData->maintenance.idleTime ||
+        (handleData->maintenance_file == NULL && now < handleData->maintenance_due))
+    {
+        return;
+    }
+    if (handleData->maintenance_file == NULL)
+    {
+        for (file = handleData->sources; file != NULL && file->dbPath == NULL; file = file->p_next);
+        if (file == NULL)
+        {
+            handleData->maintenance_due = now + (tickcounter_ms_t)handleData->maintenance.interval * 1000;
+            return;
+        }
+        handleData->maintenance_file = file;
+        handleData->maintenance_table = file;
+        handleData->maintenance_step = SQLITE_MAINTENANCE_VACUUM;
+    }
+    file = handleData->maintenance_file;
+    if (handleData->maintenance_db == NULL)
+    {
+        if (sqlite3_open(file->dbPath, &(handleData->maintenance_db)) != SQLITE_OK)
+        {
+            LogError("Can't open database %s for maintenance: %s", file->dbPath, sqlite3_errmsg(handleData->maintenance_db));
+            sqlite_maintenance_next_file(handleData, now);
+            return;
+        }
+        sqlite3_progress_handler(handleData->maintenance_db, PROGRESS_OPCODES, sqlite_progress, handleData);
+        if (handleData->memory.cacheSize > 0)
+        {
+            char sql_cache[BUFSIZE];
+            SNPRINTF_S(sql_cache, BUFSIZE, "PRAGMA cache_size=-%d;", handleData->memory.cacheSize);
+            (void)sqlite3_exec(handleData->maintenance_db, sql_cache, NULL, NULL, NULL);
+        }
+    }
+
+    /*the progress handler interrupts a statement that would overrun the slice*/
+    slice_end = now + handleData->maintenance.sliceBudget;
+    handleData->cancelled = 0;
+    handleData->timed_out = 0;
+    handleData->deadline = slice_end;
+    while (rc == SQLITE_OK && now < slice_end)
+    {
+        rc = sqlite_maintenance_step(handleData, file);
+        (void)tickcounter_get_current_ms(handleData->tick_counter, &now);
+    }
+    if (rc == SQLITE_DONE)
+    {
+        sqlite_maintenance_next_file(handleData, now);
+    }
+    else if (rc != SQLITE_OK)
+    {
+        /*a statement that does not fit in a slice would not fit in the next one either*/
+        LogError("maintenance of %s %s, moving on", file->dbPath, handleData->timed_out ? "exceeded the slice budget" : "failed");
+        if (handleData->maintenance_step == SQLITE_MAINTENANCE_VACUUM)
+            handleData->maintenance_step = SQLITE_MAINTENANCE_ANALYZE;
+        else if (handleData->maintenance_step == SQLITE_MAINTENANCE_OPTIMIZE)
+            sqlite_maintenance_next_file(handleData, now);
+    }
+    handleData->deadline = 0;
+    handleData->timed_out = 0;
+}
+/*ms the idle worker may wait for a command before its idle duties are due, 0 when they are due now*/
+static int sqlite_worker_idle_ms(SQLITE_HANDLE_DATA * handleData)
+{
+    int result = WORKER_IDLE_WAIT_MS;
+    tickcounter_ms_t now = 0;
+    if (handleData->maintenance.interval > 0 && tickcounter_get_current_ms(handleData->tick_counter, &now) == 0)
+    {
+        tickcounter_ms_t due = handleData->last_busy + (tickcounter_ms_t)handleData->maintenance.idleTime;
+        if (handleData->maintenance_file == NULL && handleData->maintenance_due > due)
+            due = handleData->maintenance_due;
+        if (handleData->maintenance_file != NULL && now >= due)
+            result = 0; /*a pass is under way, the next slice follows as long as no command is waiting*/
+        else if (due <= now)
+            result = 1;
+        else if (due - now < (tickcounter_ms_t)result)
+            result = (int)(due - now);
+    }
+    return result;
+}
+static bool sqlite_queue_empty(SQLITE_HANDLE_DATA * handleData)
+{
+    int lane_id;
+    for (lane_id = 0; lane_id < SQLITE_LANE_COUNT; lane_id++)
+    {
+        if (handleData->lanes[lane_id].head != NULL)
+            return false;
+    }
+    return true;
+}
+/*Codes_SRS_SQLITE_99_043: [ The idle worker shall wait on a condition that `Sqlite_Receive` posts when it queues a command, for no longer than its next idle duty is due. ]*/
+static bool sqlite_worker_wait(SQLITE_HANDLE_DATA * handleData)
+{
+    bool result = true;
+    int timeout = sqlite_worker_idle_ms(handleData);
+    if (timeout > 0 && Lock(handleData->queue_lock) == LOCK_OK)
+    {
+        /*checked under the lock sqlite_enqueue posts under, a command queued since the dequeue is not missed*/
+        if (!handleData->stopping && sqlite_queue_empty(handleData))
+        {
+            COND_RESULT waited = Condition_Wait(handleData->queue_cond, handleData->queue_lock, timeout);
+            result = (waited == COND_OK || waited == COND_TIMEOUT);
+        }
+        (void)Unlock(handleData->queue_lock);
+    }
+    return result;
+}
+/*defined with the rate limits, whose held commands it queues through sqlite_receive_content*/
+static void sqlite_flush_held(SQLITE_HANDLE_DATA * handleData);
+static int sqlite_worker(void * context)
+{
+    SQLITE_HANDLE_DATA * handleData = (SQLITE_HANDLE_DATA *)context;
+    (void)tickcounter_get_current_ms(handleData->tick_counter, &(handleData->last_busy));
+    while (!handleData->stopping)
+    {
+        SQLITE_WORK_ITEM * item = sqlite_dequeue(handleData);
+        if (item == NULL)
+        {
+            sqlite_flush_held(handleData);
+            if (handleData->backpressure.highBacklog > 0 || handleData->backpressure.highLatency > 0)
+            {
+                sqlite_recheck_backpressure(handleData);
+            }
+            if (handleData->maintenance.interval > 0)
+            {
+                sqlite_maintenance_slice(handleData);
+            }
+            if (!sqlite_worker_wait(handleData))
+            {
+                /*a wait that fails at once would only spin, queued commands are freed by Sqlite_Destroy*/
+                LogError("unable to wait for commands, worker stopped");
+                break;
+            }
+        }
+        else
+        {
+            JSON_Object * obj = json_value_get_object(item->json);
+            if (obj != NULL)
+            {
+                sqlite_arena_enter(&(handleData->arena));
+                sqlite_execute(handleData, obj, item->source, &(item->trace));
+                sqlite_arena_leave(&(handleData->arena));
+            }
+            json_value_free(item->json);
+            free(item);
+            (void)tickcounter_get_current_ms(handleData->tick_counter, &(handleData->last_busy));
+        }
+    }
+    return 0;
+}
+static void sqlite_dispatch(SQLITE_HANDLE_DATA * handleData, JSON_Value * json, SQLITE_SOURCE * match_source, CONSTMAP_HANDLE properties, SQLITE_TRACE * trace)
+{
+    if (handleData->scheduler)
+    {
+        /*the work queue takes ownership of json*/
+        sqlite_enqueue(handleData, json, match_source, properties, trace);
+    }
+    else
+    {
+        JSON_Object * obj = json_value_get_object(json);
+        if (obj == NULL)
+        {
+            LogError("json_value_get_obj failed");
+        }
+        else
+        {
+            sqlite_execute(handleData, obj, match_source, trace);
+        }
+        json_value_free(json);
+    }
+}
+static bool sqlite_init_lanes(SQLITE_HANDLE_DATA * handleData, const SQLITE_CONFIG * config)
+{
+    const SQLITE_SOURCE * source;
+    int lane_id;
+    handleData->scheduler = 0;
+    for (lane_id = 0; lane_id < SQLITE_LANE_COUNT; lane_id++)
+    {
+        if (config->lanes[lane_id].weight > 0)
+            handleData->scheduler = 1;
+    }
+    /*maintenance runs on the worker between commands, so it needs the worker even without lanes*/
+    if (config->maintenance.interval > 0)
+        handleData->scheduler = 1;
+    /*so does the flush of commands held by a coalescing source*/
+    for (source = config->sources; source != NULL; source = source->p_next)
+    {
+        if (source->ratePolicy == SQLITE_RATE_COALESCE && (source->rateCommands > 0 || source->rateBytes > 0))
+            handleData->scheduler = 1;
+    }
+    /*and the re-check that sends "resume" to a throttled source that went quiet*/
+    if (config->backpressure.highLatency > 0)
+        handleData->scheduler = 1;
+    for (lane_id = 0; lane_id < SQLITE_LANE_COUNT; lane_id++)
+    {
+        handleData->lanes[lane_id].weight = (config->lanes[lane_id].weight > 0) ? config->lanes[lane_id].weight : 1;
+        handleData->lanes[lane_id].latency_target = config->lanes[lane_id].latencyTarget;
+        handleData->lanes[lane_id].capacity = (config->lanes[lane_id].capacity > 0) ? (size_t)config->lanes[lane_id].capacity : DEFAULT_LANE_CAPACITY;
+    }
+    return handleData->scheduler != 0;
+}
+static MODULE_HANDLE Sqlite_Create(BROKER_HANDLE broker, const void* configuration)
+{
+    bool isValidConfig = true;
+    SQLITE_HANDLE_DATA* result = NULL;
+    char *zErrMsg = 0;
+    SQLITE_CONFIG* config = (SQLITE_CONFIG*)configuration;
+    if ((broker == NULL) || (config == NULL))
+    {
+
+        /*Codes_SRS_SQLITE_99_001: [If broker is NULL then Sqlite_Create shall fail and return NULL.]*/
+        /*Codes_SRS_SQLITE_99_002 : [If configuration is NULL then Sqlite_Create shall fail and return NULL.]*/
+        LogError("invalid arg broker=%p configuration=%p", broker, config);
+    }
+    else
+    {
+        // get library path from config
+        result = malloc(sizeof(SQLITE_HANDLE_DATA));
+        if (result != NULL)
+        {
+            char * mac;
+            int copy_result = mallocAndStrcpy_s(&mac, config->mac_address);
             if (copy_result != 0)
             {
                 /*Codes_SRS_SQLITE_99_003: [ If any system call fails, Sqlite_Create shall fail and return NULL. ]*/
@@ -475,10 +4418,67 @@ static MODULE_HANDLE Sqlite_Create(BROKER_HANDLE broker, const void* configurati
             }
             else
             {
+                memset(result, 0, sizeof(SQLITE_HANDLE_DATA));
                 result->mac_address = mac;
                 result->broker = broker;
                 result->sources = config->sources;
+                result->attach = config->attach;
+                result->trace = config->trace;
                 result->db = NULL;
+                result->tick_counter = tickcounter_create();
+                if (result->tick_counter == NULL)
+                {
+                    /*Codes_SRS_SQLITE_99_003: [ If any system call fails, Sqlite_Create shall fail and return NULL. ]*/
+                    LogError("unable to create tick counter");
+                    free(mac);
+                    free(result);
+                    result = NULL;
+                }
+                else
+                {
+                    result->request_lock = Lock_Init();
+                    if (result->request_lock == NULL)
+                    {
+                        /*Codes_SRS_SQLITE_99_003: [ If any system call fails, Sqlite_Create shall fail and return NULL. ]*/
+                        LogError("unable to create request lock");
+                        tickcounter_destroy(result->tick_counter);
+                        free(mac);
+                        free(result);
+                        result = NULL;
+                    }
+                    else if (sqlite_init_lanes(result, config) && (result->queue_lock = Lock_Init()) == NULL)
+                    {
+                        /*Codes_SRS_SQLITE_99_003: [ If any system call fails, Sqlite_Create shall fail and return NULL. ]*/
+                        LogError("unable to create work queue lock");
+                        Lock_Deinit(result->request_lock);
+                        tickcounter_destroy(result->tick_counter);
+                        free(mac);
+                        free(result);
+                        result = NULL;
+                    }
+                    else if (result->scheduler && (result->queue_cond = Condition_Init()) == NULL)
+                    {
+                        /*Codes_SRS_SQLITE_99_003: [ If any system call fails, Sqlite_Create shall fail and return NULL. ]*/
+                        LogError("unable to create work queue condition");
+                        Lock_Deinit(result->queue_lock);
+                        Lock_Deinit(result->request_lock);
+                        tickcounter_destroy(result->tick_counter);
+                        free(mac);
+                        free(result);
+                        result = NULL;
+                    }
+                    else
+                    {
+                        sqlite_configure_memory(result, config);
+                        sqlite_configure_slow_log(result, config);
+                        sqlite_configure_maintenance(result, config);
+                        sqlite_configure_backpressure(result, config);
+                        if (config->capture != NULL)
+                        {
+                            sqlite_capture_open(result, config->capture);
+                        }
+                    }
+                }
             }
         }
     }
@@ -514,18 +4514,12 @@ static void Sqlite_Start(MODULE_HANDLE module)
                 msgConfig.size = strlen(onlineText);
                 sqlite_publish(handleData->broker, handleData);
 
-                SQLITE_SOURCE * find = handleData->sources;
-                while (find)
+                sqlite_init_sources(handleData->sources, (handleData->maintenance.interval <= 0) ? 0 : (handleData->maintenance.rebuild ? 2 : 1));
+
+                if (handleData->scheduler && ThreadAPI_Create(&(handleData->worker), sqlite_worker, handleData) != THREADAPI_OK)
                 {
-                    if (sqlite_try_open_db(find->dbPath, handleData))
-                    {
-                        sqlite_try_create_table(handleData, find);
-                    }
-                    if (find->limit > 0)
-                    {
-                        sqlite_try_update_trigger(handleData, find);
-                    }
-                    find = find->p_next;
+                    LogError("unable to start worker thread, commands will not be executed");
+                    handleData->worker = NULL;
                 }
             }
         }
@@ -538,10 +4532,43 @@ static void Sqlite_Destroy(MODULE_HANDLE module)
     if (module != NULL)
     {
         SQLITE_HANDLE_DATA* handleData = (SQLITE_HANDLE_DATA*)module;
+        if (handleData->worker != NULL)
+        {
+            int notUsed;
+            handleData->stopping = 1;
+            /*under the lock, so the worker is either before its check of stopping or already waiting*/
+            if (Lock(handleData->queue_lock) == LOCK_OK)
+            {
+                (void)Condition_Post(handleData->queue_cond);
+                (void)Unlock(handleData->queue_lock);
+            }
+            if (ThreadAPI_Join(handleData->worker, &notUsed) != THREADAPI_OK)
+            {
+                LogError("unable to join worker thread");
+            }
+        }
+        if (handleData->queue_lock != NULL)
+        {
+            sqlite_free_queue(handleData);
+            if (handleData->queue_cond != NULL)
+                Condition_Deinit(handleData->queue_cond);
+            Lock_Deinit(handleData->queue_lock);
+        }
+        sqlite_stmt_cache_clear(handleData);
         if (handleData->db != NULL)
             sqlite3_close(handleData->db);
+        if (handleData->maintenance_db != NULL)
+            sqlite3_close(handleData->maintenance_db);
+        sqlite_release_memory(handleData);
+        sqlite_release_slow_log(handleData);
+        if (handleData->capture != NULL)
+            (void)fclose(handleData->capture);
         if (handleData->mac_address != NULL)
             free((char*)handleData->mac_address);
+        if (handleData->tick_counter != NULL)
+            tickcounter_destroy(handleData->tick_counter);
+        if (handleData->request_lock != NULL)
+            Lock_Deinit(handleData->request_lock);
         sqlite_source_cleanup(handleData->sources);
 		if (propertiesMap)
 			Map_Destroy(propertiesMap);
@@ -552,8 +4579,254 @@ static void Sqlite_Destroy(MODULE_HANDLE module)
 /*
 {"dbPath": "D:\\sqlite\\tools\\test.db", "sqlCommand": "select * from COMPANY;"} *** from IoTHub
 {"sqlCommand": "upsert to COMPANY;"} *** from other modules
+{"requestId": "42", "timeout": "5000", ...} *** optional, bounds the execution to 5 seconds
+{"requestType": "cancel", "requestId": "42"} *** interrupts request 42 if it is executing
+{"replyTo": "dashboard", ...} *** optional, the result carries a "target" property set to "dashboard"
+{"reply": "none", ...} *** optional, executes without publishing the result
+{"reply": "result", ...} *** from other modules, publishes the result without macAddress; a "requestId" message property does the same
 */
 
+static void sqlite_receive_content(SQLITE_HANDLE_DATA * handleData, const char * text, SQLITE_SOURCE * match_source, CONSTMAP_HANDLE properties, SQLITE_TRACE * trace)
+{
+    JSON_Value* json;
+
+    /*with a worker the arena belongs to it, the receiving thread only uses it to execute inline*/
+    if (!handleData->scheduler)
+    {
+        sqlite_arena_enter(&(handleData->arena));
+    }
+    json = json_parse_string(text);
+    if (json == NULL)
+    {
+        /*Codes_SRS_SQLITE_99_018 : [If the content of messageHandle is not a JSON value, then `Sqlite_Receive` shall fail and return NULL.]*/
+        LogError("unable to json_parse_string");
+    }
+    else
+    {
+        /*Codes_SRS_SQLITE_99_038: [ If a message from another module has a "requestId" property, `Sqlite_Receive` shall publish the result of its command with that "requestId" and without the "macAddress" property. ]*/
+        const char * reply_id = (match_source != NULL) ? ConstMap_GetValue(properties, "requestId") : NULL;
+        if (reply_id != NULL)
+        {
+            /*the command carries the request through the work queue, after the message is gone*/
+            JSON_Object * obj = json_value_get_object(json);
+            if (obj == NULL ||
+                json_object_set_string(obj, "requestId", reply_id) != JSONSuccess ||
+                (json_object_get_string(obj, "reply") == NULL && json_object_set_string(obj, "reply", "result") != JSONSuccess))
+            {
+                LogError("unable to ask for the result of request %s", reply_id);
+            }
+        }
+        sqlite_dispatch(handleData, json, match_source, properties, trace);
+    }
+    if (!handleData->scheduler)
+    {
+        sqlite_arena_leave(&(handleData->arena));
+    }
+}
+static SQLITE_RATE_STATE * sqlite_rate_state(SQLITE_HANDLE_DATA * handleData, SQLITE_SOURCE * source)
+{
+    if (source->rateState == NULL)
+    {
+        double burst = (source->rateBurst > 0) ? source->rateBurst : DEFAULT_RATE_BURST;
+        SQLITE_RATE_STATE * state = malloc(sizeof(SQLITE_RATE_STATE));
+        if (state == NULL)
+        {
+            LogError("unable to allocate rate buckets for %s", source->id);
+        }
+        else
+        {
+            memset(state, 0, sizeof(SQLITE_RATE_STATE));
+            /*a source starts with full buckets*/
+            state->commands = source->rateCommands * burst;
+            state->bytes = source->rateBytes * burst;
+            (void)tickcounter_get_current_ms(handleData->tick_counter, &(state->refilled));
+            source->rateState = state;
+        }
+    }
+    return source->rateState;
+}
+static void sqlite_rate_refill(SQLITE_HANDLE_DATA * handleData, const SQLITE_SOURCE * source, SQLITE_RATE_STATE * state)
+{
+    tickcounter_ms_t now;
+    if (tickcounter_get_current_ms(handleData->tick_counter, &now) == 0 && now > state->refilled)
+    {
+        double burst = (source->rateBurst > 0) ? source->rateBurst : DEFAULT_RATE_BURST;
+        double elapsed = (double)(now - state->refilled) / 1000;
+        state->commands += elapsed * source->rateCommands;
+        if (state->commands > source->rateCommands * burst)
+            state->commands = source->rateCommands * burst;
+        state->bytes += elapsed * source->rateBytes;
+        if (state->bytes > source->rateBytes * burst)
+            state->bytes = source->rateBytes * burst;
+        state->refilled = now;
+    }
+}
+/*charges one command and the content size when the buckets hold them, a command larger than the byte bucket is admitted from a full one and leaves it in debt*/
+static bool sqlite_rate_take(const SQLITE_SOURCE * source, SQLITE_RATE_STATE * state, size_t bytes)
+{
+    double burst = (source->rateBurst > 0) ? source->rateBurst : DEFAULT_RATE_BURST;
+    double byte_cost = ((double)bytes < source->rateBytes * burst) ? (double)bytes : source->rateBytes * burst;
+    bool result = (source->rateCommands == 0 || state->commands >= 1) && (source->rateBytes == 0 || state->bytes >= byte_cost);
+    if (result)
+    {
+        state->commands -= (source->rateCommands > 0) ? 1 : 0;
+        state->bytes -= (source->rateBytes > 0) ? (double)bytes : 0;
+    }
+    return result;
+}
+static void sqlite_reject(SQLITE_HANDLE_DATA * handleData, const SQLITE_SOURCE * source, CONSTMAP_HANDLE properties)
+{
+    const char * request_id = ConstMap_GetValue(properties, "requestId");
+    JSON_Value * error_value = json_value_init_object();
+    JSON_Object * error = json_value_get_object(error_value);
+    if (error == NULL)
+    {
+        LogError("unable to create rate limit error");
+    }
+    else
+    {
+        const char * extra_properties[3];
+        char text[BUFSIZE];
+        extra_properties[0] = "requestId";
+        extra_properties[1] = request_id;
+        extra_properties[2] = NULL;
+        SNPRINTF_S(text, BUFSIZE, "rate limit of source %s exceeded", source->id);
+        json_object_set_string(error, "error", text);
+        if (request_id != NULL)
+        {
+            json_object_set_string(error, "requestId", request_id);
+        }
+        /*an answer to another module, kept away from IoT Hub like the results of 'reply'*/
+        sqlite_publish_direct(handleData, error_value, extra_properties, 1);
+    }
+    json_value_free(error_value);
+}
+/*the held command of a coalescing source once the buckets hold its cost, NULL otherwise, the caller gets it with its properties*/
+static char * sqlite_take_held(const SQLITE_SOURCE * source, SQLITE_RATE_STATE * state, CONSTMAP_HANDLE * properties)
+{
+    char * held = NULL;
+    if (state->pending != NULL && sqlite_rate_take(source, state, state->pending_size))
+    {
+        held = state->pending;
+        *properties = state->pending_properties;
+        state->pending = NULL;
+        state->pending_properties = NULL;
+        state->admitted++;
+    }
+    return held;
+}
+static void sqlite_run_held(SQLITE_HANDLE_DATA * handleData, SQLITE_SOURCE * source, char * held, CONSTMAP_HANDLE properties)
+{
+    SQLITE_TRACE trace;
+    memset(&trace, 0, sizeof(trace));
+    if (handleData->trace)
+    {
+        trace.stamps[SQLITE_TRACE_RECEIVED] = sqlite_trace_now();
+    }
+    sqlite_receive_content(handleData, held, source, properties, &trace);
+    ConstMap_Destroy(properties);
+    free(held);
+}
+/*Codes_SRS_SQLITE_99_039: [ If the source of a message from another module has a "rate", `Sqlite_Receive` shall execute its command only while the source's command and byte buckets hold its cost, and otherwise drop it, reject it with an error or hold it in place of the previously held command, according to the source's "policy". ]*/
+static bool sqlite_admit(SQLITE_HANDLE_DATA * handleData, SQLITE_SOURCE * source, const CONSTBUFFER * content, CONSTMAP_HANDLE properties)
+{
+    bool result = false;
+    bool reject = false;
+    char * held = NULL;
+    CONSTMAP_HANDLE held_properties = NULL;
+    SQLITE_RATE_STATE * state;
+    /*with a worker the buckets and the held commands are shared with it, under the queue lock*/
+    bool locked = (handleData->queue_lock != NULL && Lock(handleData->queue_lock) == LOCK_OK);
+
+    state = sqlite_rate_state(handleData, source);
+    if (state == NULL)
+    {
+        /*no buckets, no limit*/
+        result = true;
+    }
+    else
+    {
+        sqlite_rate_refill(handleData, source, state);
+        /*the held command goes first, a command arriving behind it is over the rate as well*/
+        held = sqlite_take_held(source, state, &held_properties);
+        if (state->pending == NULL && sqlite_rate_take(source, state, content->size))
+        {
+            state->admitted++;
+            result = true;
+        }
+        else if (source->ratePolicy == SQLITE_RATE_COALESCE)
+        {
+            char * copy = malloc(content->size + 1);
+            CONSTMAP_HANDLE copy_properties = (copy != NULL) ? ConstMap_Clone(properties) : NULL;
+            if (copy_properties == NULL)
+            {
+                LogError("unable to hold command of %s, dropped", source->id);
+                free(copy);
+                state->dropped++;
+            }
+            else
+            {
+                memcpy(copy, content->buffer, content->size);
+                copy[content->size] = '\0';
+                if (state->pending != NULL)
+                {
+                    free(state->pending);
+                    ConstMap_Destroy(state->pending_properties);
+                    state->coalesced++;
+                }
+                state->pending = copy;
+                state->pending_size = content->size;
+                state->pending_properties = copy_properties;
+            }
+        }
+        else if (source->ratePolicy == SQLITE_RATE_REJECT)
+        {
+            state->rejected++;
+            reject = true;
+        }
+        else
+        {
+            state->dropped++;
+        }
+    }
+    if (locked)
+    {
+        (void)Unlock(handleData->queue_lock);
+    }
+    if (held != NULL)
+    {
+        sqlite_run_held(handleData, source, held, held_properties);
+    }
+    if (reject)
+    {
+        sqlite_reject(handleData, source, properties);
+    }
+    return result;
+}
+/*Codes_SRS_SQLITE_99_045: [ The idle worker shall run the command held by a coalescing source once the source's buckets hold its cost, without waiting for another message of the source. ]*/
+static void sqlite_flush_held(SQLITE_HANDLE_DATA * handleData)
+{
+    SQLITE_SOURCE * source;
+    for (source = handleData->sources; source != NULL; source = source->p_next)
+    {
+        char * held = NULL;
+        CONSTMAP_HANDLE properties = NULL;
+        if (source->ratePolicy == SQLITE_RATE_COALESCE && Lock(handleData->queue_lock) == LOCK_OK)
+        {
+            if (source->rateState != NULL && source->rateState->pending != NULL)
+            {
+                sqlite_rate_refill(handleData, source, source->rateState);
+                held = sqlite_take_held(source, source->rateState, &properties);
+            }
+            (void)Unlock(handleData->queue_lock);
+        }
+        if (held != NULL)
+        {
+            /*queued like any command, the worker picks it up next*/
+            sqlite_run_held(handleData, source, held, properties);
+        }
+    }
+}
 static void Sqlite_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHandle)
 {
     if (moduleHandle == NULL || messageHandle == NULL)
@@ -565,7 +4838,15 @@ static void Sqlite_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHan
     else
     {
         SQLITE_HANDLE_DATA* handleData = moduleHandle;
-        CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
+        SQLITE_TRACE trace;
+        CONSTMAP_HANDLE properties;
+
+        memset(&trace, 0, sizeof(trace));
+        if (handleData->trace)
+        {
+            trace.stamps[SQLITE_TRACE_RECEIVED] = sqlite_trace_now();
+        }
+        properties = Message_GetProperties(messageHandle);
 
         /*Codes_SRS_SQLITE_99_011: [If `messageHandle` properties does not contain a "source" property, then Sqlite_Receive shall fail and return.]*/
         /*Codes_SRS_SQLITE_99_012 : [If `messageHandle` properties contains a "deviceKey" property, then Sqlite_Receive shall fail and return.]*/
@@ -577,37 +4858,11 @@ static void Sqlite_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHan
             if (strcmp(source, "mapping") == 0 && !ConstMap_ContainsKey(properties, "deviceKey")) //from IoTHub
             {
                 const CONSTBUFFER * content = Message_GetContent(messageHandle); /*by contract, this is never NULL*/
-                JSON_Value* json = json_parse_string((const char*)content->buffer);
-                if (json == NULL)
-                {
-                    /*Codes_SRS_SQLITE_99_018 : [If the content of messageHandle is not a JSON value, then `Sqlite_Receive` shall fail and return NULL.]*/
-                    LogError("unable to json_parse_string");
-                }
-                else
+                if (handleData->capture != NULL)
                 {
-                    JSON_Object * obj = json_value_get_object(json);
-                    if (obj == NULL)
-                    {
-                        LogError("json_value_get_obj failed");
-                    }
-                    else
-                    {
-                        const char * database = json_object_get_string(obj, "dbPath");
-                        const char * sqlcmd = json_object_get_string(obj, "sqlCommand");
-                        if (database == NULL)
-                        {
-                            LogError("database is NULL");
-                        }
-                        else
-                        {
-                            if (sqlite_try_open_db(database, handleData))
-                            {
-                                sqlite_exec(handleData, (char *)sqlcmd, 1);
-                            }
-                        }
-                    }
-                    json_value_free(json);
+                    sqlite_capture(handleData, content, properties);
                 }
+                sqlite_receive_content(handleData, (const char *)content->buffer, NULL, properties, &trace);
             }
         }
         else if (sqlite_source != NULL)// from other modules
@@ -616,36 +4871,15 @@ static void Sqlite_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHan
             match_source = find_source(sqlite_source, handleData);
             if (match_source)
             {
-                if (sqlite_try_open_db(match_source->dbPath, handleData))
+                const CONSTBUFFER * content = Message_GetContent(messageHandle); /*by contract, this is never NULL*/
+                /*captured ahead of admission, so a replay meets the same rate limits*/
+                if (handleData->capture != NULL)
                 {
-                    const CONSTBUFFER * content = Message_GetContent(messageHandle); /*by contract, this is never NULL*/
-                    JSON_Value* json = json_parse_string((const char*)content->buffer);
-                    if (json == NULL)
-                    {
-                        /*Codes_SRS_SQLITE_99_018 : [If the content of messageHandle is not a JSON value, then `Sqlite_Receive` shall fail and return NULL.]*/
-                        LogError("unable to json_parse_string");
-                    }
-                    else
-                    {
-                        JSON_Object * obj = json_value_get_object(json);
-                        if (obj == NULL)
-                        {
-                            LogError("json_value_get_obj failed");
-                        }
-                        else
-                        {
-                            const char * sqlcmd = json_object_get_string(obj, "sqlCommand");
-                            if (sqlcmd == NULL)
-                            {
-                                LogError("sqlcmd is NULL");
-                            }
-                            else
-                            {
-                                sqlite_exec(handleData, (char *)sqlcmd, 0);
-                            }
-                        }
-                        json_value_free(json);
-                    }
+                    sqlite_capture(handleData, content, properties);
+                }
+                if ((match_source->rateCommands == 0 && match_source->rateBytes == 0) || sqlite_admit(handleData, match_source, content, properties))
+                {
+                    sqlite_receive_content(handleData, (const char *)content->buffer, match_source, properties, &trace);
                 }
             }
         }
@@ -722,6 +4956,10 @@ static void* Sqlite_ParseConfigurationFromJson(const char* configuration)
                                 free(result);
                                 result = NULL;
                             }
+                            else
+                            {
+                                addModuleOptions(result, obj);
+                            }
                         }
                     }
                 }
@@ -742,6 +4980,10 @@ static void Sqlite_FreeConfiguration(void* configuration)
         {
             free((char*)config->mac_address);
         }
+        if (config->capture != NULL)
+        {
+            free((char*)config->capture);
+        }
         free(config);
     }
 }
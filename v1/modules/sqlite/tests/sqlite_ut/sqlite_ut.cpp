@@ -2,6 +2,9 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <cstdlib>
+#include <ctime>
+#include <map>
+#include <string>
 #ifdef _CRTDBG_MAP_ALLOC
 #include <crtdbg.h>
 #endif
@@ -10,10 +13,12 @@
 #include "micromock.h"
 #include "micromockcharstararenullterminatedstrings.h"
 #include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
 #include "azure_c_shared_utility/constmap.h"
 #include "azure_c_shared_utility/map.h"
 #include "message.h"
 #include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/tickcounter.h"
 #include "messageproperties.h"
 #include "module_access.h"
 
@@ -66,6 +71,8 @@ static pfModule_Start Module_Start = NULL; /*gets assigned in TEST_SUITE_INITIAL
 
 //
 typedef int(*callback_type)(void*, int, char**, char**);
+typedef int(*progress_type)(void*);
+typedef void(*destructor_type)(void*);
 #define GBALLOC_H
 
 extern "C" int gballoc_init(void);
@@ -74,6 +81,8 @@ extern "C" void* gballoc_malloc(size_t size);
 extern "C" void* gballoc_calloc(size_t nmemb, size_t size);
 extern "C" void* gballoc_realloc(void* ptr, size_t size);
 extern "C" void gballoc_free(void* ptr);
+extern "C" size_t gballoc_getCurrentMemoryUsed(void);
+extern "C" size_t gballoc_getMaximumMemoryUsed(void);
 
 extern "C" int mallocAndStrcpy_s(char** destination, const char*source);
 extern "C" int unsignedIntToString(char* destination, size_t destinationSize, unsigned int value);
@@ -116,6 +125,51 @@ static const char* macAddressProperties;
 static const char* sourceProperties;
 static const char* deviceNameProperties;
 static const char* deviceKeyProperties;
+//tickcounter advances by tickStep on every read, 0 keeps time still
+static tickcounter_ms_t currentTick;
+static tickcounter_ms_t tickStep;
+//Broker_Publish advances the tickcounter by publishTicks, as a slow broker would
+static tickcounter_ms_t publishTicks;
+//sqlite3_exec and sqlite3_prepare_v2 append every statement to sqlLog, sqlite3_exec answers the ones containing execAnswerPattern[i]
+//with one row per line of execAnswerValue[i] and fails the ones containing execFailPattern
+static std::string sqlLog;
+static const char* execAnswerPattern[4];
+static const char* execAnswerValue[4];
+static const char* execFailPattern;
+//with openHandles sqlite3_open hands out a connection, appends the file to openLog and makes it what sqlite3_db_filename returns for main,
+//an ATTACH DATABASE through sqlite3_exec makes the file what it returns for the schema until the next open
+static bool openHandles;
+static std::string openLog;
+static std::string mainFile;
+static std::map<std::string, std::string> attachedFiles;
+//ConstMap_GetInternals hands out the propertyCount properties propertyKeys holding propertyValues
+static const char* propertyKeys[4];
+static const char* propertyValues[4];
+static size_t propertyCount;
+//Message_GetProperties appends every map it hands out to propertiesLog, ConstMap_GetValue every map asked for "priority" to priorityLog
+static std::string propertiesLog;
+static std::string priorityLog;
+//json_array_append_string and json_array_append_number append every value to paramLog
+static std::string paramLog;
+//sqlite3_step returns SQLITE_ROW stepRows times before SQLITE_DONE, every row has the rowColumns columns rowNames holding rowValues
+//as text and rowNumbers[stepRow] as numbers, stepRow being the row the last SQLITE_ROW stands for
+static int stepRows;
+static int stepRow;
+static int rowColumns;
+static const char* rowNames[4];
+static const char* rowValues[4];
+static double rowNumbers[8][4];
+//json_object_set_string, json_object_set_number and json_object_dotset_number append every "name=value" to resultLog
+static std::string resultLog;
+//ThreadAPI_Create runs the thread function before returning when set, so the work of a thread can be observed
+static bool runThreadsInline;
+static int threadsRun;
+//sqlite3_progress_handler keeps the handler, sqlite3_exec of a statement containing progressPattern calls it until it interrupts
+static progress_type progressHandler;
+static void * progressArg;
+static const char* progressPattern;
+//Condition_Wait times out waitTimeouts times and fails after that, which stops a worker run inline
+static int waitTimeouts;
 
 TYPED_MOCK_CLASS(CSQLiteMocks, CGlobalMock)
     {
@@ -129,6 +183,12 @@ TYPED_MOCK_CLASS(CSQLiteMocks, CGlobalMock)
             BASEIMPLEMENTATION::gballoc_free(ptr);
         MOCK_VOID_METHOD_END()
 
+        MOCK_STATIC_METHOD_0(, size_t, gballoc_getCurrentMemoryUsed)
+        MOCK_METHOD_END(size_t, (size_t)0)
+
+        MOCK_STATIC_METHOD_0(, size_t, gballoc_getMaximumMemoryUsed)
+        MOCK_METHOD_END(size_t, (size_t)0)
+
         // crt_abstractions.h
         MOCK_STATIC_METHOD_2(, int, mallocAndStrcpy_s, char**, destination, const char*, source)
         int r;
@@ -170,6 +230,47 @@ TYPED_MOCK_CLASS(CSQLiteMocks, CGlobalMock)
         }
         MOCK_METHOD_END(JSON_Object*, object);
 
+        MOCK_STATIC_METHOD_2(, JSON_Object *, json_object_get_object, const JSON_Object*, object, const char*, name)
+        MOCK_METHOD_END(JSON_Object*, (JSON_Object*)NULL);
+
+        MOCK_STATIC_METHOD_2(, JSON_Value *, json_object_get_value, const JSON_Object*, object, const char*, name)
+        MOCK_METHOD_END(JSON_Value*, (JSON_Value*)NULL);
+
+        MOCK_STATIC_METHOD_1(, JSON_Value_Type, json_value_get_type, const JSON_Value*, value)
+        MOCK_METHOD_END(JSON_Value_Type, (JSON_Value_Type)JSONError);
+
+        MOCK_STATIC_METHOD_1(, double, json_value_get_number, const JSON_Value*, value)
+        MOCK_METHOD_END(double, 0);
+
+        MOCK_STATIC_METHOD_1(, int, json_value_get_boolean, const JSON_Value*, value)
+        MOCK_METHOD_END(int, 0);
+
+        MOCK_STATIC_METHOD_1(, const char*, json_value_get_string, const JSON_Value*, value)
+        MOCK_METHOD_END(const char*, (const char*)NULL);
+
+        MOCK_STATIC_METHOD_2(, JSON_Value *, json_array_get_value, const JSON_Array *, array, size_t, index)
+        MOCK_METHOD_END(JSON_Value*, (JSON_Value*)0x48);
+
+        MOCK_STATIC_METHOD_0(, JSON_Value *, json_value_init_array);
+        MOCK_METHOD_END(JSON_Value *, (JSON_Value *)0x47);
+
+        MOCK_STATIC_METHOD_2(, JSON_Status, json_array_append_string, JSON_Array *, array, const char *, string)
+        paramLog += string;
+        paramLog += '\n';
+        MOCK_METHOD_END(JSON_Status, JSONSuccess);
+
+        MOCK_STATIC_METHOD_2(, JSON_Status, json_array_append_number, JSON_Array *, array, double, number)
+        char number_text[32];
+        sprintf(number_text, "%g\n", number);
+        paramLog += number_text;
+        MOCK_METHOD_END(JSON_Status, JSONSuccess);
+
+        MOCK_STATIC_METHOD_1(, size_t, json_object_get_count, const JSON_Object *, object)
+        MOCK_METHOD_END(size_t, (size_t)0);
+
+        MOCK_STATIC_METHOD_2(, const char*, json_object_get_name, const JSON_Object *, object, size_t, index)
+        MOCK_METHOD_END(const char*, (const char*)NULL);
+
         MOCK_STATIC_METHOD_2(, JSON_Array *, json_object_get_array, const JSON_Object*, object, const char*, name)
             JSON_Array* array = NULL;
         if (object != NULL)
@@ -254,12 +355,45 @@ TYPED_MOCK_CLASS(CSQLiteMocks, CGlobalMock)
         }
         MOCK_METHOD_END(char*, result2);
 
+        MOCK_STATIC_METHOD_1(, size_t, json_serialization_size_pretty, const JSON_Value *, value)
+        MOCK_METHOD_END(size_t, (size_t)4);
+
+        MOCK_STATIC_METHOD_3(, JSON_Status, json_serialize_to_buffer_pretty, const JSON_Value *, value, char *, buf, size_t, buf_size_in_bytes)
+            JSON_Status result2 = JSONFailure;
+        if (buf_size_in_bytes >= 4)
+        {
+            strcpy(buf, "ABC");
+            result2 = JSONSuccess;
+        }
+        MOCK_METHOD_END(JSON_Status, result2);
+
         MOCK_STATIC_METHOD_3(, JSON_Status, json_object_set_string, JSON_Object *, object, const char *, name, const char *, string)
+        resultLog += name;
+        resultLog += '=';
+        resultLog += (string != NULL) ? string : "NULL";
+        resultLog += '\n';
+        MOCK_METHOD_END(JSON_Status, JSONSuccess);
+
+        MOCK_STATIC_METHOD_3(, JSON_Status, json_object_set_number, JSON_Object *, object, const char *, name, double, number)
+        char number_text[64];
+        sprintf(number_text, "=%g\n", number);
+        resultLog += name;
+        resultLog += number_text;
         MOCK_METHOD_END(JSON_Status, JSONSuccess);
 
         MOCK_STATIC_METHOD_3(, JSON_Status, json_object_dotset_string, JSON_Object *, object, const char *, name, const char *, string)
         MOCK_METHOD_END(JSON_Status, JSONSuccess);
 
+        MOCK_STATIC_METHOD_3(, JSON_Status, json_object_dotset_number, JSON_Object *, object, const char *, name, double, number)
+        char number_text[64];
+        sprintf(number_text, "=%g\n", number);
+        resultLog += name;
+        resultLog += number_text;
+        MOCK_METHOD_END(JSON_Status, JSONSuccess);
+
+        MOCK_STATIC_METHOD_2(, void, json_set_allocation_functions, JSON_Malloc_Function, malloc_fun, JSON_Free_Function, free_fun)
+        MOCK_VOID_METHOD_END();
+
         MOCK_STATIC_METHOD_0(, JSON_Value *, json_value_init_object);
         MOCK_METHOD_END(JSON_Value *, (JSON_Value *)0x47);
 
@@ -278,6 +412,7 @@ TYPED_MOCK_CLASS(CSQLiteMocks, CGlobalMock)
 
             MOCK_STATIC_METHOD_3(, BROKER_RESULT, Broker_Publish, BROKER_HANDLE, bus, MODULE_HANDLE, handle, MESSAGE_HANDLE, message)
             BROKER_RESULT brokerResult = currentBrokerResult;
+            currentTick += publishTicks;
         MOCK_METHOD_END(BROKER_RESULT, brokerResult)
 
             // ConstMap mocks
@@ -303,6 +438,12 @@ TYPED_MOCK_CLASS(CSQLiteMocks, CGlobalMock)
 
             MOCK_STATIC_METHOD_2(, const char*, ConstMap_GetValue, CONSTMAP_HANDLE, handle, const char*, key)
             const char * result5 = VALID_VALUE;
+        if (strcmp("priority", key) == 0)
+        {
+            char map_text[32];
+            sprintf(map_text, "%p\n", (void *)handle);
+            priorityLog += map_text;
+        }
         if (strcmp(GW_MAC_ADDRESS_PROPERTY, key) == 0)
         {
             result5 = "01:01:01:01:01:01";
@@ -317,6 +458,12 @@ TYPED_MOCK_CLASS(CSQLiteMocks, CGlobalMock)
 		}
         MOCK_METHOD_END(const char *, result5)
 
+            MOCK_STATIC_METHOD_4(, CONSTMAP_RESULT, ConstMap_GetInternals, CONSTMAP_HANDLE, handle, const char*const**, keys, const char*const**, values, size_t*, count)
+            *keys = (propertyCount > 0) ? propertyKeys : NULL;
+            *values = (propertyCount > 0) ? propertyValues : NULL;
+            *count = propertyCount;
+        MOCK_METHOD_END(CONSTMAP_RESULT, CONSTMAP_OK)
+
             MOCK_STATIC_METHOD_2(, bool, ConstMap_ContainsKey, CONSTMAP_HANDLE, handle, const char*, key)
             bool result5 = false;
         if (strcmp("deviceKey", key) == 0)
@@ -380,7 +527,10 @@ TYPED_MOCK_CLASS(CSQLiteMocks, CGlobalMock)
 
             MOCK_STATIC_METHOD_1(, CONSTMAP_HANDLE, Message_GetProperties, MESSAGE_HANDLE, message)
             CONSTMAP_HANDLE result1;
+            char map_text[32];
             result1 = ConstMap_Create((MAP_HANDLE)VALID_MAP_HANDLE);
+            sprintf(map_text, "%p\n", (void *)result1);
+            propertiesLog += map_text;
         MOCK_METHOD_END(CONSTMAP_HANDLE, result1)
 
             MOCK_STATIC_METHOD_1(, const CONSTBUFFER*, Message_GetContent, MESSAGE_HANDLE, message)
@@ -400,6 +550,12 @@ TYPED_MOCK_CLASS(CSQLiteMocks, CGlobalMock)
 
             MOCK_STATIC_METHOD_3( , THREADAPI_RESULT, ThreadAPI_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg)
         THREADAPI_RESULT result8 = THREADAPI_OK;
+        if (runThreadsInline)
+        {
+            *threadHandle = (THREAD_HANDLE)0x49;
+            threadsRun++;
+            (void)func(arg);
+        }
         MOCK_METHOD_END(THREADAPI_RESULT, result8)
 
             MOCK_STATIC_METHOD_2( , THREADAPI_RESULT, ThreadAPI_Join, THREAD_HANDLE, threadHandle, int*, res)
@@ -442,43 +598,251 @@ TYPED_MOCK_CLASS(CSQLiteMocks, CGlobalMock)
             result10 = LOCK_OK;
 		MOCK_METHOD_END(LOCK_RESULT, result10)
 
+		//condition
+		MOCK_STATIC_METHOD_0(, COND_HANDLE, Condition_Init)
+		COND_HANDLE result12 = (COND_HANDLE)0x45;
+		MOCK_METHOD_END(COND_HANDLE, result12)
+
+		MOCK_STATIC_METHOD_1(, COND_RESULT, Condition_Post, COND_HANDLE, handle)
+		MOCK_METHOD_END(COND_RESULT, COND_OK)
+
+		MOCK_STATIC_METHOD_3(, COND_RESULT, Condition_Wait, COND_HANDLE, handle, LOCK_HANDLE, lock, int, timeout_milliseconds)
+		COND_RESULT result13 = (waitTimeouts > 0) ? COND_TIMEOUT : COND_ERROR;
+		if (waitTimeouts > 0)
+			waitTimeouts--;
+		MOCK_METHOD_END(COND_RESULT, result13)
+
+		MOCK_STATIC_METHOD_1(, void, Condition_Deinit, COND_HANDLE, handle)
+		MOCK_VOID_METHOD_END()
+
 		//sqlite3
 		MOCK_STATIC_METHOD_1(, int, sqlite3_close, sqlite3 *, handle)
 		MOCK_METHOD_END(int, 0)
 
 		MOCK_STATIC_METHOD_5(, int, sqlite3_exec, sqlite3 *, handle, const char *, sql, callback_type, callback, void *, arg, char **, errmsg)
-		MOCK_METHOD_END(int, 0)
+		int result12 = 0;
+		sqlLog += sql;
+		sqlLog += '\n';
+		if (execFailPattern != NULL && strstr(sql, execFailPattern) != NULL)
+		{
+			result12 = SQLITE_ERROR;
+		}
+		else if (openHandles && strncmp(sql, "ATTACH DATABASE '", 17) == 0)
+		{
+			std::string attach = sql + 17;
+			size_t as = attach.find("' AS \"");
+			attachedFiles[attach.substr(as + 6, attach.find('"', as + 6) - as - 6)] = attach.substr(0, as);
+		}
+		else if (progressPattern != NULL && progressHandler != NULL && strstr(sql, progressPattern) != NULL)
+		{
+			for (int step = 0; step < 100 && result12 == 0; step++)
+			{
+				if (progressHandler(progressArg) != 0)
+					result12 = SQLITE_INTERRUPT;
+			}
+		}
+		else if (callback != NULL)
+		{
+			for (int answer = 0; answer < 4; answer++)
+			{
+				if (execAnswerPattern[answer] != NULL && strstr(sql, execAnswerPattern[answer]) != NULL)
+				{
+					std::string rows = execAnswerValue[answer];
+					size_t start = 0;
+					size_t end;
+					do
+					{
+						end = rows.find('\n', start);
+						std::string row = rows.substr(start, (end == std::string::npos) ? std::string::npos : end - start);
+						char * value = (char *)row.c_str();
+						char * name = (char *)"c";
+						(void)callback(arg, 1, &value, &name);
+						start = end + 1;
+					} while (end != std::string::npos);
+					break;
+				}
+			}
+		}
+		MOCK_METHOD_END(int, result12)
 
 		MOCK_STATIC_METHOD_1(, void, sqlite3_free, void *, handle)
 		MOCK_VOID_METHOD_END()
 
 		MOCK_STATIC_METHOD_2(, int, sqlite3_open, const char *, filename, sqlite3 **, ppDb)
+		if (openHandles)
+		{
+			*ppDb = (sqlite3 *)0x50;
+			openLog += filename;
+			openLog += '\n';
+			mainFile = filename;
+			attachedFiles.clear();
+		}
 		MOCK_METHOD_END(int, 0)
 
 		MOCK_STATIC_METHOD_1(, const char *, sqlite3_errmsg, sqlite3 *, pDb)
 		MOCK_METHOD_END(const char *, NULL)
 
 		MOCK_STATIC_METHOD_2(, const char *, sqlite3_db_filename, sqlite3 *, pDb, const char *, main)
-		MOCK_METHOD_END(const char *, NULL)
+		const char * result19 = NULL;
+		if (openHandles && strcmp(main, "main") == 0)
+			result19 = mainFile.c_str();
+		else if (openHandles && attachedFiles.count(main) != 0)
+			result19 = attachedFiles[main].c_str();
+		MOCK_METHOD_END(const char *, result19)
+
+		MOCK_STATIC_METHOD_4(, void, sqlite3_progress_handler, sqlite3 *, pDb, int, nOps, progress_type, xProgress, void *, arg)
+		progressHandler = xProgress;
+		progressArg = arg;
+		MOCK_VOID_METHOD_END()
+
+		MOCK_STATIC_METHOD_1(, void, sqlite3_interrupt, sqlite3 *, pDb)
+		MOCK_VOID_METHOD_END()
+
+		MOCK_STATIC_METHOD_1(, sqlite3_int64, sqlite3_soft_heap_limit64, sqlite3_int64, limit)
+		MOCK_METHOD_END(sqlite3_int64, 0)
+
+		MOCK_STATIC_METHOD_1(, sqlite3_int64, sqlite3_hard_heap_limit64, sqlite3_int64, limit)
+		MOCK_METHOD_END(sqlite3_int64, 0)
+
+		MOCK_STATIC_METHOD_0(, sqlite3_int64, sqlite3_memory_used)
+		MOCK_METHOD_END(sqlite3_int64, 0)
+
+		MOCK_STATIC_METHOD_1(, sqlite3_int64, sqlite3_memory_highwater, int, resetFlag)
+		MOCK_METHOD_END(sqlite3_int64, 0)
+
+		MOCK_STATIC_METHOD_4(, int, sqlite3_status64, int, op, sqlite3_int64 *, pCurrent, sqlite3_int64 *, pHighwater, int, resetFlag)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_5(, int, sqlite3_db_status, sqlite3 *, pDb, int, op, int *, pCurrent, int *, pHighwater, int, resetFlag)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_1(, int, sqlite3_db_release_memory, sqlite3 *, pDb)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_5(, int, sqlite3_prepare_v2, sqlite3 *, pDb, const char *, zSql, int, nByte, sqlite3_stmt **, ppStmt, const char **, pzTail)
+		sqlLog += zSql;
+		sqlLog += '\n';
+		*ppStmt = (sqlite3_stmt *)0x50;
+		if (pzTail != NULL)
+			*pzTail = NULL;
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_1(, int, sqlite3_finalize, sqlite3_stmt *, pStmt)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_1(, int, sqlite3_changes, sqlite3 *, pDb)
+		MOCK_METHOD_END(int, 1)
+
+		MOCK_STATIC_METHOD_1(, int, sqlite3_step, sqlite3_stmt *, pStmt)
+		int result13 = SQLITE_DONE;
+		if (stepRows > 0)
+		{
+			stepRows--;
+			stepRow++;
+			result13 = SQLITE_ROW;
+		}
+		MOCK_METHOD_END(int, result13)
+
+		MOCK_STATIC_METHOD_1(, int, sqlite3_reset, sqlite3_stmt *, pStmt)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_1(, int, sqlite3_clear_bindings, sqlite3_stmt *, pStmt)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_3(, int, sqlite3_bind_int64, sqlite3_stmt *, pStmt, int, index, sqlite3_int64, value)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_3(, int, sqlite3_bind_double, sqlite3_stmt *, pStmt, int, index, double, value)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_5(, int, sqlite3_bind_text, sqlite3_stmt *, pStmt, int, index, const char *, value, int, n, destructor_type, destructor)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_5(, int, sqlite3_bind_blob, sqlite3_stmt *, pStmt, int, index, const void *, value, int, n, destructor_type, destructor)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_2(, int, sqlite3_bind_null, sqlite3_stmt *, pStmt, int, index)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_1(, int, sqlite3_bind_parameter_count, sqlite3_stmt *, pStmt)
+		MOCK_METHOD_END(int, 1)
+
+		MOCK_STATIC_METHOD_2(, int, sqlite3_bind_parameter_index, sqlite3_stmt *, pStmt, const char *, zName)
+		MOCK_METHOD_END(int, 0)
+
+		MOCK_STATIC_METHOD_1(, int, sqlite3_column_count, sqlite3_stmt *, pStmt)
+		MOCK_METHOD_END(int, rowColumns)
+
+		MOCK_STATIC_METHOD_2(, const char *, sqlite3_column_name, sqlite3_stmt *, pStmt, int, index)
+		const char * result14 = (index < rowColumns) ? rowNames[index] : "c";
+		MOCK_METHOD_END(const char *, result14)
+
+		MOCK_STATIC_METHOD_2(, const unsigned char *, sqlite3_column_text, sqlite3_stmt *, pStmt, int, index)
+		const unsigned char * result15 = (index < rowColumns) ? (const unsigned char *)rowValues[index] : (const unsigned char *)NULL;
+		MOCK_METHOD_END(const unsigned char *, result15)
+
+		MOCK_STATIC_METHOD_2(, sqlite3_int64, sqlite3_column_int64, sqlite3_stmt *, pStmt, int, index)
+		sqlite3_int64 result16 = (index < rowColumns && stepRow >= 0 && stepRow < 8) ? (sqlite3_int64)rowNumbers[stepRow][index] : 0;
+		MOCK_METHOD_END(sqlite3_int64, result16)
+
+		MOCK_STATIC_METHOD_2(, double, sqlite3_column_double, sqlite3_stmt *, pStmt, int, index)
+		double result17 = (index < rowColumns && stepRow >= 0 && stepRow < 8) ? rowNumbers[stepRow][index] : 0.0;
+		MOCK_METHOD_END(double, result17)
+
+		MOCK_STATIC_METHOD_2(, int, sqlite3_column_type, sqlite3_stmt *, pStmt, int, index)
+		int result18 = (index < rowColumns) ? SQLITE_FLOAT : SQLITE_NULL;
+		MOCK_METHOD_END(int, result18)
+
+		//tickcounter
+		MOCK_STATIC_METHOD_0(, TICK_COUNTER_HANDLE, tickcounter_create)
+		TICK_COUNTER_HANDLE result11 = (TICK_COUNTER_HANDLE)0x46;
+		MOCK_METHOD_END(TICK_COUNTER_HANDLE, result11)
+
+		MOCK_STATIC_METHOD_1(, void, tickcounter_destroy, TICK_COUNTER_HANDLE, tick_counter)
+		MOCK_VOID_METHOD_END()
+
+		MOCK_STATIC_METHOD_2(, int, tickcounter_get_current_ms, TICK_COUNTER_HANDLE, tick_counter, tickcounter_ms_t*, current_ms)
+		*current_ms = currentTick;
+		currentTick += tickStep;
+		MOCK_METHOD_END(int, 0)
     };
 
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , void*, gballoc_malloc, size_t, size);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , void, gballoc_free, void*, ptr);
+DECLARE_GLOBAL_MOCK_METHOD_0(CSQLiteMocks, , size_t, gballoc_getCurrentMemoryUsed);
+DECLARE_GLOBAL_MOCK_METHOD_0(CSQLiteMocks, , size_t, gballoc_getMaximumMemoryUsed);
 DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , int, mallocAndStrcpy_s, char**, destination, const char*, source);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , JSON_Value*, json_parse_string, const char *, filename);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , JSON_Array*, json_value_get_array, const JSON_Value*, value);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , JSON_Object*, json_value_get_object, const JSON_Value*, value);
 DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , const char*, json_object_get_string, const JSON_Object*, object, const char*, name);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , JSON_Object *, json_object_get_object, const JSON_Object*, object, const char*, name);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , JSON_Value *, json_object_get_value, const JSON_Object*, object, const char*, name);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , JSON_Value_Type, json_value_get_type, const JSON_Value*, value);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , double, json_value_get_number, const JSON_Value*, value);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , int, json_value_get_boolean, const JSON_Value*, value);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , const char*, json_value_get_string, const JSON_Value*, value);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , JSON_Value *, json_array_get_value, const JSON_Array *, array, size_t, index);
+DECLARE_GLOBAL_MOCK_METHOD_0(CSQLiteMocks, , JSON_Value *, json_value_init_array);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , JSON_Status, json_array_append_string, JSON_Array *, array, const char *, string);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , JSON_Status, json_array_append_number, JSON_Array *, array, double, number);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , size_t, json_object_get_count, const JSON_Object *, object);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , const char*, json_object_get_name, const JSON_Object *, object, size_t, index);
 DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , JSON_Array *, json_object_get_array, const JSON_Object*, object, const char*, name);
 DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , JSON_Object *, json_array_get_object, const JSON_Array *, array, size_t, index);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , size_t, json_array_get_count, const JSON_Array *, array);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , void, json_value_free, JSON_Value*, value);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , void, json_free_serialized_string, char*, value);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , char *, json_serialize_to_string_pretty, const JSON_Value*, value); 
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , size_t, json_serialization_size_pretty, const JSON_Value*, value);
+DECLARE_GLOBAL_MOCK_METHOD_3(CSQLiteMocks, , JSON_Status, json_serialize_to_buffer_pretty, const JSON_Value*, value, char *, buf, size_t, buf_size_in_bytes);
 DECLARE_GLOBAL_MOCK_METHOD_3(CSQLiteMocks, , JSON_Status, json_object_set_string, JSON_Object *, object, const char *, name, const char *, string);
+DECLARE_GLOBAL_MOCK_METHOD_3(CSQLiteMocks, , JSON_Status, json_object_set_number, JSON_Object *, object, const char *, name, double, number);
 DECLARE_GLOBAL_MOCK_METHOD_3(CSQLiteMocks, , JSON_Status, json_object_dotset_string, JSON_Object *, object, const char *, name, const char *, string);
+DECLARE_GLOBAL_MOCK_METHOD_3(CSQLiteMocks, , JSON_Status, json_object_dotset_number, JSON_Object *, object, const char *, name, double, number);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , void, json_set_allocation_functions, JSON_Malloc_Function, malloc_fun, JSON_Free_Function, free_fun);
 DECLARE_GLOBAL_MOCK_METHOD_0(CSQLiteMocks, , JSON_Value *, json_value_init_object);
 
 DECLARE_GLOBAL_MOCK_METHOD_0(CSQLiteMocks, , BROKER_HANDLE, Broker_Create);
@@ -491,6 +855,7 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , CONSTMAP_HANDLE, ConstMap_Clone, CO
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , void, ConstMap_Destroy, CONSTMAP_HANDLE, map);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , MAP_HANDLE, ConstMap_CloneWriteable, CONSTMAP_HANDLE, handle);
 DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , const char*, ConstMap_GetValue, CONSTMAP_HANDLE, handle, const char *, key);
+DECLARE_GLOBAL_MOCK_METHOD_4(CSQLiteMocks, , CONSTMAP_RESULT, ConstMap_GetInternals, CONSTMAP_HANDLE, handle, const char*const**, keys, const char*const**, values, size_t*, count);
 
 DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , CONSTBUFFER_HANDLE, CONSTBUFFER_Create, const unsigned char*, source, size_t, size);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , CONSTBUFFER_HANDLE, CONSTBUFFER_Clone, CONSTBUFFER_HANDLE, constbufferHandle);
@@ -518,13 +883,82 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , LOCK_RESULT, Lock, LOCK_HANDLE,  ha
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , LOCK_RESULT, Unlock, LOCK_HANDLE,  handle);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , LOCK_RESULT, Lock_Deinit, LOCK_HANDLE,  handle);
 
+DECLARE_GLOBAL_MOCK_METHOD_0(CSQLiteMocks, , COND_HANDLE, Condition_Init);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , COND_RESULT, Condition_Post, COND_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_3(CSQLiteMocks, , COND_RESULT, Condition_Wait, COND_HANDLE, handle, LOCK_HANDLE, lock, int, timeout_milliseconds);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , void, Condition_Deinit, COND_HANDLE, handle);
+
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , int, sqlite3_close, sqlite3 *, handle);
 DECLARE_GLOBAL_MOCK_METHOD_5(CSQLiteMocks, , int, sqlite3_exec, sqlite3 *, handle, const char *, sql, callback_type, callback, void *, arg, char **, errmsg);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , void, sqlite3_free, void *, handle);
 DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , int, sqlite3_open, const char *, filename, sqlite3 **, ppDb);
 DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , const char *, sqlite3_errmsg, sqlite3 *, handle);
 DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , const char *, sqlite3_db_filename, sqlite3 *, handle, const char *, main);
+DECLARE_GLOBAL_MOCK_METHOD_4(CSQLiteMocks, , void, sqlite3_progress_handler, sqlite3 *, pDb, int, nOps, progress_type, xProgress, void *, arg);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , void, sqlite3_interrupt, sqlite3 *, pDb);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , sqlite3_int64, sqlite3_soft_heap_limit64, sqlite3_int64, limit);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , sqlite3_int64, sqlite3_hard_heap_limit64, sqlite3_int64, limit);
+DECLARE_GLOBAL_MOCK_METHOD_0(CSQLiteMocks, , sqlite3_int64, sqlite3_memory_used);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , sqlite3_int64, sqlite3_memory_highwater, int, resetFlag);
+DECLARE_GLOBAL_MOCK_METHOD_4(CSQLiteMocks, , int, sqlite3_status64, int, op, sqlite3_int64 *, pCurrent, sqlite3_int64 *, pHighwater, int, resetFlag);
+DECLARE_GLOBAL_MOCK_METHOD_5(CSQLiteMocks, , int, sqlite3_db_status, sqlite3 *, pDb, int, op, int *, pCurrent, int *, pHighwater, int, resetFlag);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , int, sqlite3_db_release_memory, sqlite3 *, pDb);
+DECLARE_GLOBAL_MOCK_METHOD_5(CSQLiteMocks, , int, sqlite3_prepare_v2, sqlite3 *, pDb, const char *, zSql, int, nByte, sqlite3_stmt **, ppStmt, const char **, pzTail);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , int, sqlite3_finalize, sqlite3_stmt *, pStmt);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , int, sqlite3_changes, sqlite3 *, pDb);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , int, sqlite3_step, sqlite3_stmt *, pStmt);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , int, sqlite3_reset, sqlite3_stmt *, pStmt);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , int, sqlite3_clear_bindings, sqlite3_stmt *, pStmt);
+DECLARE_GLOBAL_MOCK_METHOD_3(CSQLiteMocks, , int, sqlite3_bind_int64, sqlite3_stmt *, pStmt, int, index, sqlite3_int64, value);
+DECLARE_GLOBAL_MOCK_METHOD_3(CSQLiteMocks, , int, sqlite3_bind_double, sqlite3_stmt *, pStmt, int, index, double, value);
+DECLARE_GLOBAL_MOCK_METHOD_5(CSQLiteMocks, , int, sqlite3_bind_text, sqlite3_stmt *, pStmt, int, index, const char *, value, int, n, destructor_type, destructor);
+DECLARE_GLOBAL_MOCK_METHOD_5(CSQLiteMocks, , int, sqlite3_bind_blob, sqlite3_stmt *, pStmt, int, index, const void *, value, int, n, destructor_type, destructor);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , int, sqlite3_bind_null, sqlite3_stmt *, pStmt, int, index);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , int, sqlite3_bind_parameter_count, sqlite3_stmt *, pStmt);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , int, sqlite3_bind_parameter_index, sqlite3_stmt *, pStmt, const char *, zName);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , int, sqlite3_column_count, sqlite3_stmt *, pStmt);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , const char *, sqlite3_column_name, sqlite3_stmt *, pStmt, int, index);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , const unsigned char *, sqlite3_column_text, sqlite3_stmt *, pStmt, int, index);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , sqlite3_int64, sqlite3_column_int64, sqlite3_stmt *, pStmt, int, index);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , double, sqlite3_column_double, sqlite3_stmt *, pStmt, int, index);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , int, sqlite3_column_type, sqlite3_stmt *, pStmt, int, index);
+
+DECLARE_GLOBAL_MOCK_METHOD_0(CSQLiteMocks, , TICK_COUNTER_HANDLE, tickcounter_create);
+DECLARE_GLOBAL_MOCK_METHOD_1(CSQLiteMocks, , void, tickcounter_destroy, TICK_COUNTER_HANDLE, tick_counter);
+DECLARE_GLOBAL_MOCK_METHOD_2(CSQLiteMocks, , int, tickcounter_get_current_ms, TICK_COUNTER_HANDLE, tick_counter, tickcounter_ms_t*, current_ms);
+
+static char * test_copy(const char * text)
+{
+    char * result = (char *)malloc(strlen(text) + 1);
+    strcpy(result, text);
+    return result;
+}
 
+//a source with one TEXT column in front of next, owned by the module once the config is passed to Module_Create
+static SQLITE_SOURCE * test_source(const char * dbPath, const char * table, SQLITE_SOURCE * next)
+{
+    SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+    memset(source, 0, sizeof(SQLITE_SOURCE));
+    SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+    memset(column, 0, sizeof(SQLITE_COLUMN));
+    column->name = test_copy("VALUE");
+    column->type = test_copy("TEXT");
+    source->id = test_copy(table);
+    source->dbPath = test_copy(dbPath);
+    source->table = test_copy(table);
+    source->columns = column;
+    source->p_next = next;
+    return source;
+}
+
+static SQLITE_CONFIG * test_config(SQLITE_SOURCE * sources)
+{
+    SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+    memset(config, 0, sizeof(SQLITE_CONFIG));
+    config->mac_address = "01:01:01:01:01:01";
+    config->sources = sources;
+    return config;
+}
 
 BEGIN_TEST_SUITE(sqlite_ut)
 
@@ -555,7 +989,31 @@ BEGIN_TEST_SUITE(sqlite_ut)
         {
             ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
         }
-
+        currentTick = 0;
+        tickStep = 0;
+        publishTicks = 0;
+        sqlLog.clear();
+        memset(execAnswerPattern, 0, sizeof(execAnswerPattern));
+        memset(execAnswerValue, 0, sizeof(execAnswerValue));
+        execFailPattern = NULL;
+        openHandles = false;
+        propertyCount = 0;
+        propertiesLog.clear();
+        priorityLog.clear();
+        openLog.clear();
+        mainFile.clear();
+        attachedFiles.clear();
+        paramLog.clear();
+        stepRows = 0;
+        stepRow = -1;
+        rowColumns = 0;
+        resultLog.clear();
+        runThreadsInline = false;
+        threadsRun = 0;
+        waitTimeouts = 0;
+        progressHandler = NULL;
+        progressArg = NULL;
+        progressPattern = NULL;
     }
 
     TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -674,12 +1132,42 @@ BEGIN_TEST_SUITE(sqlite_ut)
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "notNull"))
 			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "fullText"))
+			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreArgument(1)
 			.IgnoreArgument(2);
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreArgument(1)
 			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "indexes"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "partition"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "rate"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "lanes"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "memory"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "heap"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "slowQuery"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "attach"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "maintenance"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "trace"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "capture"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "backpressure"))
+			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 
@@ -1097,6 +1585,8 @@ BEGIN_TEST_SUITE(sqlite_ut)
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "notNull"))
 			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "fullText"))
+			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
@@ -1187,6 +1677,8 @@ BEGIN_TEST_SUITE(sqlite_ut)
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "notNull"))
 			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "fullText"))
+			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
@@ -1277,6 +1769,8 @@ BEGIN_TEST_SUITE(sqlite_ut)
 			.SetFailReturn((const char *)NULL);
 		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "notNull"))
 			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "fullText"))
+			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
@@ -1367,6 +1861,133 @@ BEGIN_TEST_SUITE(sqlite_ut)
 		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "notNull"))
 			.IgnoreArgument(1)
 			.SetFailReturn((const char *)NULL);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "fullText"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+
+        //Act
+        auto n = Module_ParseConfigurationFromJson(config);
+
+        ///Assert
+        ASSERT_IS_NULL(n);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+    }
+
+    //Tests_SRS_SQLITE_JSON_99_053: [ If an `indexes` object does not contain a value named "name" or "columns" then Sqlite_ParseConfigurationFromJson shall fail and return NULL. ]
+    TEST_FUNCTION(SQLite_ParseConfigurationFromJson_index_without_columns_returns_null)
+    {
+        ///Arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        const char* config = "pretend this is a valid JSON string";
+
+		STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "macAddress"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "sources"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.SetReturn((size_t)1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "id"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "table"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "limit"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "columns"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.SetReturn((size_t)1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "name"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "primaryKey"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "notNull"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "fullText"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "indexes"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.SetReturn((size_t)1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "name"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "columns"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "include"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "where"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "unique"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
@@ -1579,6 +2200,8 @@ BEGIN_TEST_SUITE(sqlite_ut)
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreArgument(1)
 			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, tickcounter_create());
+		STRICT_EXPECTED_CALL(mocks, Lock_Init());
 
 
         //Act
@@ -1595,8 +2218,8 @@ BEGIN_TEST_SUITE(sqlite_ut)
         Module_Destroy(n);
     }
 
-    //Tests_SRS_SQLITE_99_007: [ If SQLite_Create encounters any errors while creating the SQLite_HANDLE_DATA then it shall fail and return NULL. ]
-    TEST_FUNCTION(SQLite_Create_Fail_malloc)
+    //Tests_SRS_SQLITE_99_021: [ SQLite_Create shall apply the configured heap limits through `sqlite3_soft_heap_limit64` and `sqlite3_hard_heap_limit64`. ]
+    TEST_FUNCTION(SQLite_Create_applies_heap_limits)
     {
         ///Arrange
         CSQLiteMocks mocks;
@@ -1605,6 +2228,8 @@ BEGIN_TEST_SUITE(sqlite_ut)
 		SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
 		memset(config, 0, sizeof(SQLITE_CONFIG));
 		config->mac_address = "01:01:01:01:01:01";
+		config->memory.softHeapLimit = 32 * 1024 * 1024;
+		config->memory.hardHeapLimit = 48 * 1024 * 1024;
 		SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
 		memset(source, 0, sizeof(SQLITE_SOURCE));
 		SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
@@ -1613,22 +2238,28 @@ BEGIN_TEST_SUITE(sqlite_ut)
 		config->sources = source;
 
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreArgument(1)
-            .SetFailReturn((void*)NULL);
-
+            .IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, tickcounter_create());
+		STRICT_EXPECTED_CALL(mocks, Lock_Init());
+		STRICT_EXPECTED_CALL(mocks, sqlite3_soft_heap_limit64(32 * 1024 * 1024));
+		STRICT_EXPECTED_CALL(mocks, sqlite3_hard_heap_limit64(48 * 1024 * 1024));
 
         //Act
         auto n = Module_Create(broker, config);
 
         ///Assert
-        ASSERT_IS_NULL(n);
+        ASSERT_IS_NOT_NULL(n);
         mocks.AssertActualAndExpectedCalls();
 
         ///Cleanup
+        Module_Destroy(n);
     }
 
-    //Tests_SRS_SQLITE_99_007: [ If SQLite_Create encounters any errors while creating the SQLite_HANDLE_DATA then it shall fail and return NULL. ]
-    TEST_FUNCTION(SQLite_Create_Fail_mallocAndStrcpy_s)
+    //Tests_SRS_SQLITE_99_022: [ If "arenaSize" is configured, SQLite_Create shall allocate the message arena and leave the parson allocator alone. ]
+    TEST_FUNCTION(SQLite_Create_allocates_message_arena)
     {
         ///Arrange
         CSQLiteMocks mocks;
@@ -1637,6 +2268,7 @@ BEGIN_TEST_SUITE(sqlite_ut)
 		SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
 		memset(config, 0, sizeof(SQLITE_CONFIG));
 		config->mac_address = "01:01:01:01:01:01";
+		config->heap.arenaSize = 65536;
 		SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
 		memset(source, 0, sizeof(SQLITE_SOURCE));
 		SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
@@ -1646,7 +2278,76 @@ BEGIN_TEST_SUITE(sqlite_ut)
 
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, tickcounter_create());
+		STRICT_EXPECTED_CALL(mocks, Lock_Init());
+		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(65536));
+
+        //Act
+        auto n = Module_Create(broker, config);
+
+        ///Assert
+        ASSERT_IS_NOT_NULL(n);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_007: [ If SQLite_Create encounters any errors while creating the SQLite_HANDLE_DATA then it shall fail and return NULL. ]
+    TEST_FUNCTION(SQLite_Create_Fail_malloc)
+    {
+        ///Arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+		SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+		memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+		SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+		memset(source, 0, sizeof(SQLITE_SOURCE));
+		SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+		memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((void*)NULL);
+
+
+        //Act
+        auto n = Module_Create(broker, config);
+
+        ///Assert
+        ASSERT_IS_NULL(n);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+    }
+
+    //Tests_SRS_SQLITE_99_007: [ If SQLite_Create encounters any errors while creating the SQLite_HANDLE_DATA then it shall fail and return NULL. ]
+    TEST_FUNCTION(SQLite_Create_Fail_mallocAndStrcpy_s)
+    {
+        ///Arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+		SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+		memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+		SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+		memset(source, 0, sizeof(SQLITE_SOURCE));
+		SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+		memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreArgument(1)
 			.IgnoreArgument(2)
             .SetFailReturn((int)-1);
@@ -1708,6 +2409,10 @@ BEGIN_TEST_SUITE(sqlite_ut)
 
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, tickcounter_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Lock_Deinit(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
@@ -1979,9 +2684,28 @@ BEGIN_TEST_SUITE(sqlite_ut)
 		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
 			.IgnoreArgument(1)
 			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "params"))
+			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, sqlite3_open(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreArgument(1)
 			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_progress_handler(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
 		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
@@ -2025,4 +2749,3069 @@ BEGIN_TEST_SUITE(sqlite_ut)
 
         Module_Destroy(n);
     }
+
+    //Tests_SRS_SQLITE_99_044: [ While a command executes, its result shall be serialized into the message arena with `json_serialize_to_buffer_pretty`. ]
+    TEST_FUNCTION(SQLite_Receive_with_arena_serializes_result_into_it)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+        //const char* valid_json = "\"address\":\"400001\",\"value\":\"999\",\"uid\":\"1\"";
+
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Value* json = (JSON_Value*)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        LOCK_HANDLE fake_lock = (LOCK_HANDLE)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+		config->heap.arenaSize = 65536;
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "params"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_open(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_progress_handler(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_exec(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3)
+			.IgnoreArgument(4)
+			.IgnoreArgument(5);
+		STRICT_EXPECTED_CALL(mocks, json_serialization_size_pretty(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_serialize_to_buffer_pretty(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 4))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Broker_Publish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_027: [ If a command takes longer than the slowQuery threshold, `Sqlite_Receive` shall log its duration, row count and query plan and keep a sample of them for the "slowlog" request. ]
+    TEST_FUNCTION(SQLite_Receive_slow_command_is_explained_and_kept)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+        //const char* valid_json = "\"address\":\"400001\",\"value\":\"999\",\"uid\":\"1\"";
+
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Value* json = (JSON_Value*)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        LOCK_HANDLE fake_lock = (LOCK_HANDLE)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+		config->slowQuery.threshold = 10;
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+        tickStep = 50;
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "params"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_open(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_progress_handler(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
+		STRICT_EXPECTED_CALL(mocks, sqlite3_exec(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3)
+			.IgnoreArgument(4)
+			.IgnoreArgument(5);
+		STRICT_EXPECTED_CALL(mocks, tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
+		STRICT_EXPECTED_CALL(mocks, json_serialize_to_string_pretty(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Broker_Publish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_prepare_v2(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
+		STRICT_EXPECTED_CALL(mocks, sqlite3_step(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_finalize(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_027: [ If a command takes longer than the slowQuery threshold, `Sqlite_Receive` shall log its duration, row count and query plan and keep a sample of them for the "slowlog" request. ]
+    TEST_FUNCTION(SQLite_Receive_slow_publish_does_not_make_command_slow)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = test_config(test_source("D:\\test.db", "MODBUS", NULL));
+        config->slowQuery.threshold = 10;
+
+        auto n = Module_Create(broker, config);
+        Module_Start(n);
+        sqlLog.clear();
+        publishTicks = 100;
+
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        ASSERT_IS_TRUE(sqlLog.find("select * from MODBUS;") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("EXPLAIN QUERY PLAN") == std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_024: [ If the content of messageHandle has a "params" array or object, `Sqlite_Receive` shall bind it to the single statement in "sqlCommand" by position or by name, reusing the prepared statement. ]
+    TEST_FUNCTION(SQLite_Receive_with_params_binds_and_steps)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+        //const char* valid_json = "\"address\":\"400001\",\"value\":\"999\",\"uid\":\"1\"";
+
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Value* json = (JSON_Value*)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        JSON_Value * params = (JSON_Value *)0x49;
+        JSON_Value * value = (JSON_Value *)0x48;
+        sqlite3_stmt * stmt = (sqlite3_stmt *)0x50;
+        LOCK_HANDLE fake_lock = (LOCK_HANDLE)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "params"))
+			.IgnoreArgument(1)
+			.SetReturn(params);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_open(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_progress_handler(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
+		STRICT_EXPECTED_CALL(mocks, json_value_get_type(params))
+			.SetReturn((JSON_Value_Type)JSONArray);
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_prepare_v2(IGNORED_PTR_ARG, IGNORED_PTR_ARG, -1, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(4)
+			.IgnoreArgument(5);
+		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_value_get_type(params))
+			.SetReturn((JSON_Value_Type)JSONArray);
+		STRICT_EXPECTED_CALL(mocks, json_value_get_array(params));
+		STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.SetReturn((size_t)1);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_bind_parameter_count(stmt));
+		STRICT_EXPECTED_CALL(mocks, json_array_get_value(IGNORED_PTR_ARG, 0))
+			.IgnoreArgument(1)
+			.SetReturn(value);
+		STRICT_EXPECTED_CALL(mocks, json_value_get_type(value))
+			.SetReturn((JSON_Value_Type)JSONNumber);
+		STRICT_EXPECTED_CALL(mocks, json_value_get_number(value))
+			.SetReturn(42.0);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_bind_int64(stmt, 1, 42));
+		STRICT_EXPECTED_CALL(mocks, sqlite3_column_count(stmt));
+		STRICT_EXPECTED_CALL(mocks, sqlite3_step(stmt));
+		STRICT_EXPECTED_CALL(mocks, sqlite3_reset(stmt));
+		STRICT_EXPECTED_CALL(mocks, sqlite3_clear_bindings(stmt));
+		STRICT_EXPECTED_CALL(mocks, json_serialize_to_string_pretty(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Broker_Publish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_025: [ If the content of messageHandle has "requestType" set to "batch", `Sqlite_Receive` shall execute every entry of "statements" in one transaction and publish one combined result. ]
+    TEST_FUNCTION(SQLite_Receive_batch_runs_in_one_transaction)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+        //const char* valid_json = "\"address\":\"400001\",\"value\":\"999\",\"uid\":\"1\"";
+
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Value* json = (JSON_Value*)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        LOCK_HANDLE fake_lock = (LOCK_HANDLE)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("batch");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "statements"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "atomic"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_open(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_progress_handler(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
+		STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.SetReturn((size_t)1);
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_exec(IGNORED_PTR_ARG, "SAVEPOINT gw_batch;", IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(3)
+			.IgnoreArgument(4)
+			.IgnoreArgument(5);
+		STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "params"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_exec(IGNORED_PTR_ARG, "SAVEPOINT gw_statement;", IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(3)
+			.IgnoreArgument(4)
+			.IgnoreArgument(5);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_exec(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3)
+			.IgnoreArgument(4)
+			.IgnoreArgument(5);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_changes(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_dotset_number(IGNORED_PTR_ARG, "batch[0].changes", 1))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_exec(IGNORED_PTR_ARG, "RELEASE gw_statement;", IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(3)
+			.IgnoreArgument(4)
+			.IgnoreArgument(5);
+		STRICT_EXPECTED_CALL(mocks, sqlite3_exec(IGNORED_PTR_ARG, "RELEASE gw_batch;", IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(3)
+			.IgnoreArgument(4)
+			.IgnoreArgument(5);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_number(IGNORED_PTR_ARG, "statements", 1))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_number(IGNORED_PTR_ARG, "failed", 0))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_serialize_to_string_pretty(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Broker_Publish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_019: [ If the content of messageHandle has "requestType" set to "cancel", `Sqlite_Receive` shall interrupt the executing command with the same "requestId" and shall not execute any command. ]
+    TEST_FUNCTION(SQLite_Receive_cancel_does_not_execute)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("42");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("cancel");
+		STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_035: [ If the content of messageHandle has "requestType" set to "trace", `Sqlite_Receive` shall publish the count, mean, maximum and percentiles of every traced stage. ]
+    TEST_FUNCTION(SQLite_Receive_trace_request_publishes_report)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("42");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("trace");
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_number(IGNORED_PTR_ARG, "trace", IGNORED_NUM_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_string(IGNORED_PTR_ARG, "requestId", "42"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_serialize_to_string_pretty(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Clone(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, "requestId", "42"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Broker_Publish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_037: [ The result of a command shall carry its "requestId" and, if the command has a "replyTo", a "target" property set to it, so receivers can discard results meant for other modules without parsing them. ]
+    TEST_FUNCTION(SQLite_Receive_reply_to_addresses_result)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("42");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("dashboard");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("trace");
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_number(IGNORED_PTR_ARG, "trace", IGNORED_NUM_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_string(IGNORED_PTR_ARG, "requestId", "42"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_serialize_to_string_pretty(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Clone(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, "requestId", "42"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, "target", "dashboard"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Broker_Publish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    TEST_FUNCTION(SQLite_Receive_reply_none_does_not_publish)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("42");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("none");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("trace");
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_number(IGNORED_PTR_ARG, "trace", IGNORED_NUM_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_string(IGNORED_PTR_ARG, "requestId", "42"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_038: [ If a message from another module has a "requestId" property, `Sqlite_Receive` shall publish the result of its command with that "requestId" and without the "macAddress" property. ]
+    TEST_FUNCTION(SQLite_Receive_from_module_with_requestId_publishes_result)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "src1";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        char * id = (char *)malloc(5);
+        strcpy(id, "src1");
+        source->id = id;
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn((const char *)NULL);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn(valid_source);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("7");
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_string(obj, "requestId", "7"));
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(obj, "reply"));
+		STRICT_EXPECTED_CALL(mocks, json_object_set_string(obj, "reply", "result"));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("7");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("result");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("trace");
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_number(IGNORED_PTR_ARG, "trace", IGNORED_NUM_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_string(IGNORED_PTR_ARG, "requestId", "7"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_serialize_to_string_pretty(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Clone(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, "requestId", "7"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Delete(IGNORED_PTR_ARG, "macAddress"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Broker_Publish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_039: [ If the source of a message from another module has a "rate", `Sqlite_Receive` shall execute its command only while the source's command and byte buckets hold its cost, and otherwise drop it, reject it with an error or hold it in place of the previously held command, according to the source's "policy". ]
+    TEST_FUNCTION(SQLite_Receive_over_rate_is_dropped_before_parsing)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "src1";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        char * id = (char *)malloc(5);
+        strcpy(id, "src1");
+        source->id = id;
+        source->rateCommands = 1;
+        source->ratePolicy = SQLITE_RATE_DROP;
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+        /*the first command empties the bucket and time stands still*/
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn((const char *)NULL);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+        Module_Receive(n, messageHandle);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn((const char *)NULL);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn(valid_source);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_029: [ If the content of messageHandle has "requestType" set to "range", `Sqlite_Receive` shall publish one page of the table ordered by "column" after "cursor", with the cursor of the next page when the page is full. ]
+    TEST_FUNCTION(SQLite_Receive_range_on_unconfigured_table_does_not_execute)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("42");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("range");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "table"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "column"))
+			.IgnoreArgument(1)
+			.SetReturn("DATETIME");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "start"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "end"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "cursor"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "pageSize"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_029: [ If the content of messageHandle has "requestType" set to "range", `Sqlite_Receive` shall publish one page of the table ordered by "column" after "cursor", with the cursor of the next page when the page is full. ]
+    TEST_FUNCTION(SQLite_Receive_range_full_page_carries_cursor_of_last_row)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+
+        auto n = Module_Create(broker, test_config(test_source("D:\\test.db", "MODBUS", NULL)));
+        Module_Start(n);
+        sqlLog.clear();
+        resultLog.clear();
+        paramLog.clear();
+        stepRows = 2;
+        rowColumns = 2;
+        rowNames[0] = "gw_rowid";
+        rowValues[0] = "8";
+        rowNames[1] = "VALUE";
+        rowValues[1] = "ab";
+
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+            .IgnoreArgument(1)
+            .SetReturn("range");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "column"))
+            .IgnoreArgument(1)
+            .SetReturn("VALUE");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "pageSize"))
+            .IgnoreArgument(1)
+            .SetReturn("2");
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        ASSERT_IS_TRUE(sqlLog.find("SELECT rowid AS gw_rowid, * FROM MODBUS WHERE 1 ORDER BY VALUE, rowid LIMIT ?;") != std::string::npos);
+        ASSERT_ARE_EQUAL(char_ptr, "2\n", paramLog.c_str());
+        /*rowid, then the hex of the key value of the last row*/
+        ASSERT_IS_TRUE(resultLog.find("cursor=8:6162\n") != std::string::npos);
+
+        ///Cleanup
+        rowColumns = 0;
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_029: [ If the content of messageHandle has "requestType" set to "range", `Sqlite_Receive` shall publish one page of the table ordered by "column" after "cursor", with the cursor of the next page when the page is full. ]
+    TEST_FUNCTION(SQLite_Receive_range_with_cursor_seeks_past_it)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+
+        auto n = Module_Create(broker, test_config(test_source("D:\\test.db", "MODBUS", NULL)));
+        Module_Start(n);
+        sqlLog.clear();
+        resultLog.clear();
+        paramLog.clear();
+        stepRows = 1;
+        rowColumns = 2;
+        rowNames[0] = "gw_rowid";
+        rowValues[0] = "8";
+        rowNames[1] = "VALUE";
+        rowValues[1] = "ab";
+
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+            .IgnoreArgument(1)
+            .SetReturn("range");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "column"))
+            .IgnoreArgument(1)
+            .SetReturn("VALUE");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "pageSize"))
+            .IgnoreArgument(1)
+            .SetReturn("2");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "cursor"))
+            .IgnoreArgument(1)
+            .SetReturn("8:6162");
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        ASSERT_IS_TRUE(sqlLog.find("SELECT rowid AS gw_rowid, * FROM MODBUS WHERE 1 AND (VALUE, rowid) > (?, ?) ORDER BY VALUE, rowid LIMIT ?;") != std::string::npos);
+        ASSERT_ARE_EQUAL(char_ptr, "ab\n8\n2\n", paramLog.c_str());
+        /*a short page is the last one*/
+        ASSERT_IS_TRUE(resultLog.find("cursor=") == std::string::npos);
+
+        ///Cleanup
+        rowColumns = 0;
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_030: [ If the content of messageHandle has "requestType" set to "aggregate", `Sqlite_Receive` shall publish the requested functions of "columns" per "bucket" of the key "column", computed in one pass over the range. ]
+    TEST_FUNCTION(SQLite_Receive_aggregate_on_unconfigured_table_does_not_execute)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "sqlCommand"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("42");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("aggregate");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "table"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "column"))
+			.IgnoreArgument(1)
+			.SetReturn("DATETIME");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "columns"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "functions"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "bucket"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "start"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "end"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_030: [ If the content of messageHandle has "requestType" set to "aggregate", `Sqlite_Receive` shall publish the requested functions of "columns" per "bucket" of the key "column", computed in one pass over the range. ]
+    TEST_FUNCTION(SQLite_Receive_aggregate_floors_negative_keys_into_their_own_bucket)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+
+        auto n = Module_Create(broker, test_config(test_source("D:\\test.db", "MODBUS", NULL)));
+        Module_Start(n);
+        sqlLog.clear();
+        resultLog.clear();
+
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+            .IgnoreArgument(1)
+            .SetReturn("aggregate");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "column"))
+            .IgnoreArgument(1)
+            .SetReturn("VALUE");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "columns"))
+            .IgnoreArgument(1)
+            .SetReturn("VALUE");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "bucket"))
+            .IgnoreArgument(1)
+            .SetReturn("10");
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        /*floor of the quotient, CAST alone truncates toward zero and would put -1 into the bucket starting at 0*/
+        ASSERT_IS_TRUE(sqlLog.find("SELECT (CAST(CAST(CASE WHEN typeof(VALUE) IN ('integer', 'real') THEN VALUE ELSE strftime('%s', VALUE) END AS REAL) / 10 AS INTEGER)"
+            " - (CAST(CASE WHEN typeof(VALUE) IN ('integer', 'real') THEN VALUE ELSE strftime('%s', VALUE) END AS REAL) / 10"
+            " < CAST(CAST(CASE WHEN typeof(VALUE) IN ('integer', 'real') THEN VALUE ELSE strftime('%s', VALUE) END AS REAL) / 10 AS INTEGER))) * 10 AS gw_bucket, VALUE"
+            " FROM MODBUS WHERE VALUE IS NOT NULL ORDER BY VALUE") != std::string::npos);
+        ASSERT_IS_TRUE(resultLog.find("bucketCount=0\n") != std::string::npos);
+
+        ///Cleanup
+        rowColumns = 0;
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_030: [ If the content of messageHandle has "requestType" set to "aggregate", `Sqlite_Receive` shall publish the requested functions of "columns" per "bucket" of the key "column", computed in one pass over the range. ]
+    TEST_FUNCTION(SQLite_Receive_aggregate_computes_each_function_per_bucket)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+
+        auto n = Module_Create(broker, test_config(test_source("D:\\test.db", "MODBUS", NULL)));
+        Module_Start(n);
+        sqlLog.clear();
+        resultLog.clear();
+        /*bucket, then the value of each row*/
+        stepRows = 4;
+        rowColumns = 2;
+        rowNumbers[0][0] = -10;
+        rowNumbers[0][1] = 4;
+        rowNumbers[1][0] = -10;
+        rowNumbers[1][1] = 2;
+        rowNumbers[2][0] = 0;
+        rowNumbers[2][1] = 5;
+        rowNumbers[3][0] = 0;
+        rowNumbers[3][1] = 7;
+
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+            .IgnoreArgument(1)
+            .SetReturn("aggregate");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "column"))
+            .IgnoreArgument(1)
+            .SetReturn("VALUE");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "columns"))
+            .IgnoreArgument(1)
+            .SetReturn("VALUE");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "bucket"))
+            .IgnoreArgument(1)
+            .SetReturn("10");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "functions"))
+            .IgnoreArgument(1)
+            .SetReturn("min,max,avg,sum,count,first,last");
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr,
+            "buckets[0].start=-10\n"
+            "buckets[0].rows=2\n"
+            "buckets[0].VALUE.min=2\n"
+            "buckets[0].VALUE.max=4\n"
+            "buckets[0].VALUE.avg=3\n"
+            "buckets[0].VALUE.sum=6\n"
+            "buckets[0].VALUE.count=2\n"
+            "buckets[0].VALUE.first=4\n"
+            "buckets[0].VALUE.last=2\n"
+            "buckets[1].start=0\n"
+            "buckets[1].rows=2\n"
+            "buckets[1].VALUE.min=5\n"
+            "buckets[1].VALUE.max=7\n"
+            "buckets[1].VALUE.avg=6\n"
+            "buckets[1].VALUE.sum=12\n"
+            "buckets[1].VALUE.count=2\n"
+            "buckets[1].VALUE.first=5\n"
+            "buckets[1].VALUE.last=7\n"
+            "bucketCount=2\n", resultLog.c_str());
+
+        ///Cleanup
+        rowColumns = 0;
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_020: [ If lanes are configured, `Sqlite_Receive` shall queue the command to the lane of its priority instead of executing it. ]
+    TEST_FUNCTION(SQLite_Receive_with_lanes_queues_command)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+		config->lanes[SQLITE_LANE_INGEST].weight = 8;
+		config->lanes[SQLITE_LANE_INTERACTIVE].weight = 2;
+		config->lanes[SQLITE_LANE_BULK].weight = 1;
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "priority"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn((const char *)NULL);
+		STRICT_EXPECTED_CALL(mocks, tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
+		STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Condition_Post(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_042: [ If the lane of a command already holds its capacity, `Sqlite_Receive` shall refuse the command and publish an error with its "requestId" unless it asked for no reply. ]
+    TEST_FUNCTION(SQLite_Receive_to_full_lane_is_refused_with_error)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+		config->lanes[SQLITE_LANE_INTERACTIVE].weight = 1;
+		config->lanes[SQLITE_LANE_INTERACTIVE].capacity = 1;
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+        Module_Start(n);
+        /*the first command from IoT Hub fills the interactive lane*/
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        Module_Receive(n, messageHandle);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn("9");
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "priority"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn((const char *)NULL);
+		STRICT_EXPECTED_CALL(mocks, tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
+		STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_init_object());
+		STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_string(IGNORED_PTR_ARG, "error", "lane interactive is full"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_object_set_string(IGNORED_PTR_ARG, "requestId", "9"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_serialize_to_string_pretty(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Clone(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, "requestId", "9"))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Broker_Publish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_033: [ If "maintenance" is configured, the worker shall run incremental vacuum, ANALYZE and PRAGMA optimize on every database file in slices of at most sliceBudget ms once the work queues have been empty for idleTime ms. ]
+    TEST_FUNCTION(SQLite_Receive_with_maintenance_queues_command)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        const char* valid_source = "mapping";
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = (SQLITE_CONFIG *)malloc(sizeof(SQLITE_CONFIG));
+        memset(config, 0, sizeof(SQLITE_CONFIG));
+		config->mac_address = "01:01:01:01:01:01";
+		config->maintenance.interval = 3600;
+        SQLITE_SOURCE * source = (SQLITE_SOURCE *)malloc(sizeof(SQLITE_SOURCE));
+        memset(source, 0, sizeof(SQLITE_SOURCE));
+        SQLITE_COLUMN * column = (SQLITE_COLUMN *)malloc(sizeof(SQLITE_COLUMN));
+        memset(column, 0, sizeof(SQLITE_COLUMN));
+		source->columns = column;
+		config->sources = source;
+
+        auto n = Module_Create(broker, config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(messageHandle))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(valid_source);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetReturn(false);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Value*)malloc(1));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(obj);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "replyTo"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "reply"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+		STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "priority"))
+			.IgnoreArgument(1)
+			.IgnoreArgument(2)
+			.SetReturn((const char *)NULL);
+		STRICT_EXPECTED_CALL(mocks, tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreAllArguments();
+		STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Condition_Post(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+
+        Module_Destroy(n);
+    }
+    //Tests_SRS_SQLITE_99_023: [ `Sqlite_Start` shall create each table and trigger only when the stored fingerprint of its source differs, initializing distinct database files in parallel. ]
+    TEST_FUNCTION(SQLite_Start_skips_ddl_of_unchanged_source)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+
+        auto n = Module_Create(broker, test_config(test_source("a.db", "readings", NULL)));
+        Module_Start(n);
+        Module_Destroy(n);
+        size_t stored = sqlLog.find("VALUES ('readings', '");
+        ASSERT_IS_TRUE(stored != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("create table if not exists readings") != std::string::npos);
+        std::string fingerprint = sqlLog.substr(stored + strlen("VALUES ('readings', '"), 16);
+
+        n = Module_Create(broker, test_config(test_source("a.db", "readings", NULL)));
+        sqlLog.clear();
+        execAnswerPattern[0] = "SELECT fingerprint FROM";
+        execAnswerValue[0] = fingerprint.c_str();
+
+        ///act
+        Module_Start(n);
+
+        ///assert
+        ASSERT_IS_TRUE(sqlLog.find("AND EXISTS (SELECT 1 FROM sqlite_master WHERE name='readings'") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("create table if not exists readings") == std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("INSERT OR REPLACE") == std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_023: [ `Sqlite_Start` shall create each table and trigger only when the stored fingerprint of its source differs, initializing distinct database files in parallel. ]
+    TEST_FUNCTION(SQLite_Start_initializes_each_database_file_on_its_own_thread)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+
+        auto n = Module_Create(broker, test_config(test_source("a.db", "readings", test_source("b.db", "events", test_source("a.db", "alarms", NULL)))));
+        runThreadsInline = true;
+
+        ///act
+        Module_Start(n);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 2, threadsRun);
+        /*one transaction per file, the two tables of a.db share theirs*/
+        size_t first = sqlLog.find("BEGIN IMMEDIATE;");
+        ASSERT_IS_TRUE(first != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("BEGIN IMMEDIATE;", first + 1) != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("BEGIN IMMEDIATE;", sqlLog.find("BEGIN IMMEDIATE;", first + 1) + 1) == std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("create table if not exists readings") < sqlLog.find("create table if not exists alarms"));
+        ASSERT_IS_TRUE(sqlLog.find("create table if not exists alarms") < sqlLog.find("create table if not exists events"));
+
+        ///Cleanup
+        runThreadsInline = false;
+        Module_Destroy(n);
+    }
+    //Tests_SRS_SQLITE_99_023: [ `Sqlite_Start` shall create each table and trigger only when the stored fingerprint of its source differs, initializing distinct database files in parallel. ]
+    TEST_FUNCTION(SQLite_Start_creates_fulltext_index_and_its_triggers)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        SQLITE_SOURCE * source = test_source("a.db", "notes", NULL);
+        source->columns->fullText = 1;
+
+        auto n = Module_Create(broker, test_config(source));
+
+        ///act
+        Module_Start(n);
+
+        ///assert
+        ASSERT_IS_TRUE(sqlLog.find("CREATE VIRTUAL TABLE notes_fts USING fts5(VALUE, content='notes', content_rowid='rowid');") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("CREATE TRIGGER notes_fts_ai AFTER INSERT ON notes BEGIN INSERT INTO notes_fts(rowid, VALUE) VALUES (new.rowid, new.VALUE); END;") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("CREATE TRIGGER notes_fts_ad AFTER DELETE ON notes BEGIN INSERT INTO notes_fts(notes_fts, rowid, VALUE) VALUES ('delete', old.rowid, old.VALUE); END;") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("CREATE TRIGGER notes_fts_au AFTER UPDATE ON notes") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("INSERT INTO notes_fts(notes_fts) VALUES ('rebuild');") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("INSERT OR REPLACE INTO gw_schema_fingerprint (tbl, fingerprint) VALUES ('notes', ") != std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_023: [ `Sqlite_Start` shall create each table and trigger only when the stored fingerprint of its source differs, initializing distinct database files in parallel. ]
+    TEST_FUNCTION(SQLite_Start_without_fts5_keeps_table_and_retries_index_next_start)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        SQLITE_SOURCE * source = test_source("a.db", "notes", NULL);
+        source->columns->fullText = 1;
+        execFailPattern = "USING fts5";
+
+        auto n = Module_Create(broker, test_config(source));
+
+        ///act
+        Module_Start(n);
+
+        ///assert
+        ASSERT_IS_TRUE(sqlLog.find("create table if not exists notes") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("CREATE TRIGGER notes_fts_") == std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("INSERT OR REPLACE INTO gw_schema_fingerprint") == std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("COMMIT;") != std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_026: [ If the content of messageHandle has "requestType" set to "search", `Sqlite_Receive` shall publish the rowids, ranks and snippets matching "query" in the full text index of the table. ]
+    TEST_FUNCTION(SQLite_Receive_search_queries_fulltext_index)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_SOURCE * source = test_source("D:\\test.db", "MODBUS", NULL);
+        source->columns->fullText = 1;
+
+        auto n = Module_Create(broker, test_config(source));
+        Module_Start(n);
+        sqlLog.clear();
+        paramLog.clear();
+
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+            .IgnoreArgument(1)
+            .SetReturn("search");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "query"))
+            .IgnoreArgument(1)
+            .SetReturn("pump NEAR fault");
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        ASSERT_IS_TRUE(sqlLog.find("SELECT rowid, rank, snippet(MODBUS_fts, -1, '[', ']', '...', 16) AS snippet FROM MODBUS_fts WHERE MODBUS_fts MATCH ? ORDER BY rank LIMIT ?;") != std::string::npos);
+        /*the query is bound, never part of the SQL text, "limit" comes from the request*/
+        ASSERT_ARE_EQUAL(char_ptr, "pump NEAR fault\n10\n", paramLog.c_str());
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+    //Tests_SRS_SQLITE_99_031: [ For a partitioned source, the module shall insert into the partition of the current interval, drop partitions beyond "keep" and expose the kept ones as a view named after the table. ]
+    TEST_FUNCTION(SQLite_Start_creates_current_partition_behind_view)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        SQLITE_SOURCE * source = test_source("a.db", "readings", NULL);
+        source->partitionInterval = 86400;
+        source->partitionKeep = 2;
+        std::string period = std::to_string((long long)time(NULL) / 86400);
+
+        auto n = Module_Create(broker, test_config(source));
+        execAnswerPattern[0] = "name GLOB 'readings_p[0-9]*'";
+        execAnswerValue[0] = period.c_str();
+
+        ///act
+        Module_Start(n);
+
+        ///assert
+        ASSERT_IS_TRUE(sqlLog.find("create table if not exists readings_p" + period + " (") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("create table if not exists readings (") == std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("CREATE VIEW readings (VALUE) AS SELECT VALUE FROM readings_p" + period + ";") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("CREATE TRIGGER readings_partition_insert INSTEAD OF INSERT ON readings BEGIN INSERT INTO readings_p" + period +
+            " (VALUE) VALUES (new.VALUE); END;") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("DROP TABLE") == std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_031: [ For a partitioned source, the module shall insert into the partition of the current interval, drop partitions beyond "keep" and expose the kept ones as a view named after the table. ]
+    TEST_FUNCTION(SQLite_Start_rotation_drops_partitions_beyond_keep)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        SQLITE_SOURCE * source = test_source("a.db", "readings", NULL);
+        source->partitionInterval = 86400;
+        source->partitionKeep = 2;
+        long long current = (long long)time(NULL) / 86400;
+        std::string periods = std::to_string(current) + "\n" + std::to_string(current - 1) + "\n" + std::to_string(current - 2);
+
+        auto n = Module_Create(broker, test_config(source));
+        execAnswerPattern[0] = "name GLOB 'readings_p[0-9]*'";
+        execAnswerValue[0] = periods.c_str();
+
+        ///act
+        Module_Start(n);
+
+        ///assert
+        ASSERT_IS_TRUE(sqlLog.find("DROP TABLE IF EXISTS readings_p" + std::to_string(current - 2) + ";") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("DROP TABLE IF EXISTS readings_p" + std::to_string(current - 1) + ";") == std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("CREATE VIEW readings (VALUE) AS SELECT VALUE FROM readings_p" + std::to_string(current) +
+            " UNION ALL SELECT VALUE FROM readings_p" + std::to_string(current - 1) + ";") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("INSERT INTO readings_p" + std::to_string(current) + " (VALUE)") != std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_031: [ For a partitioned source, the module shall insert into the partition of the current interval, drop partitions beyond "keep" and expose the kept ones as a view named after the table. ]
+    TEST_FUNCTION(SQLite_Start_migrates_plain_table_into_current_partition)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        SQLITE_SOURCE * source = test_source("a.db", "readings", NULL);
+        source->partitionInterval = 86400;
+        source->partitionKeep = 2;
+        std::string period = std::to_string((long long)time(NULL) / 86400);
+
+        auto n = Module_Create(broker, test_config(source));
+        execAnswerPattern[0] = "SELECT type FROM sqlite_master WHERE name='readings';";
+        execAnswerValue[0] = "table";
+        execAnswerPattern[1] = "name GLOB 'readings_p[0-9]*'";
+        execAnswerValue[1] = period.c_str();
+
+        ///act
+        Module_Start(n);
+
+        ///assert
+        /*the rows stay where they are, the table becomes the partition before the view takes its name*/
+        size_t rename = sqlLog.find("ALTER TABLE readings RENAME TO readings_p" + period + ";");
+        ASSERT_IS_TRUE(rename != std::string::npos);
+        ASSERT_IS_TRUE(rename < sqlLog.find("CREATE VIEW readings (VALUE)"));
+        ASSERT_IS_TRUE(sqlLog.find("DELETE") == std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_031: [ For a partitioned source, the module shall insert into the partition of the current interval, drop partitions beyond "keep" and expose the kept ones as a view named after the table. ]
+    TEST_FUNCTION(SQLite_Start_without_partition_drops_view_and_keeps_partitions)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+
+        auto n = Module_Create(broker, test_config(test_source("a.db", "readings", NULL)));
+        execAnswerPattern[0] = "SELECT type FROM sqlite_master WHERE name='readings';";
+        execAnswerValue[0] = "view";
+
+        ///act
+        Module_Start(n);
+
+        ///assert
+        size_t drop = sqlLog.find("DROP VIEW readings;");
+        ASSERT_IS_TRUE(drop != std::string::npos);
+        ASSERT_IS_TRUE(drop < sqlLog.find("create table if not exists readings ("));
+        ASSERT_IS_TRUE(sqlLog.find("DROP TABLE") == std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_030: [ If the content of messageHandle has "requestType" set to "aggregate", `Sqlite_Receive` shall publish the requested functions of "columns" per "bucket" of the key "column", computed in one pass over the range. ]
+    TEST_FUNCTION(SQLite_Receive_aggregate_on_partitioned_table_orders_by_key_only)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_SOURCE * source = test_source("D:\\test.db", "MODBUS", NULL);
+        source->partitionInterval = 86400;
+        std::string period = std::to_string((long long)time(NULL) / 86400);
+
+        auto n = Module_Create(broker, test_config(source));
+        execAnswerPattern[0] = "name GLOB 'MODBUS_p[0-9]*'";
+        execAnswerValue[0] = period.c_str();
+        Module_Start(n);
+        sqlLog.clear();
+
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+            .IgnoreArgument(1)
+            .SetReturn("aggregate");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "column"))
+            .IgnoreArgument(1)
+            .SetReturn("VALUE");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "columns"))
+            .IgnoreArgument(1)
+            .SetReturn("VALUE");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "bucket"))
+            .IgnoreArgument(1)
+            .SetReturn("10");
+
+        ///act
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        /*the view over the partitions has no rowid*/
+        ASSERT_IS_TRUE(sqlLog.find(" FROM MODBUS WHERE VALUE IS NOT NULL ORDER BY VALUE;") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("rowid") == std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+    //Tests_SRS_SQLITE_99_032: [ If "attach" is configured, the connection shall attach every other configured database file under the id of its first source, and a command for an attached file shall run on the same connection against that schema. ]
+    TEST_FUNCTION(SQLite_Receive_with_attach_keeps_one_connection_for_alternating_files)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_CONFIG * config = test_config(test_source("a.db", "readings", test_source("b.db", "events", NULL)));
+        config->attach = 1;
+        openHandles = true;
+
+        auto n = Module_Create(broker, config);
+        Module_Start(n);
+        openLog.clear();
+        sqlLog.clear();
+
+        ///act
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+            .IgnoreArgument(1)
+            .SetReturn("a.db");
+        Module_Receive(n, messageHandle);
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+            .IgnoreArgument(1)
+            .SetReturn("b.db");
+        Module_Receive(n, messageHandle);
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+            .IgnoreArgument(1)
+            .SetReturn("a.db");
+        Module_Receive(n, messageHandle);
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+            .IgnoreArgument(1)
+            .SetReturn("b.db");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+            .IgnoreArgument(1)
+            .SetReturn("range");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "table"))
+            .IgnoreArgument(1)
+            .SetReturn("events");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "column"))
+            .IgnoreArgument(1)
+            .SetReturn("VALUE");
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, "a.db\n", openLog.c_str());
+        ASSERT_IS_TRUE(sqlLog.find("ATTACH DATABASE 'b.db' AS \"events\";") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("ATTACH DATABASE 'b.db' AS \"events\";", sqlLog.find("ATTACH DATABASE 'b.db'") + 1) == std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("ATTACH DATABASE 'a.db'") == std::string::npos);
+        /*the module's own statements on b.db name its schema*/
+        ASSERT_IS_TRUE(sqlLog.find("SELECT rowid AS gw_rowid, * FROM \"events\".events WHERE 1 ORDER BY VALUE, rowid LIMIT ?;") != std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_031: [ For a partitioned source, the module shall insert into the partition of the current interval, drop partitions beyond "keep" and expose the kept ones as a view named after the table. ]
+    TEST_FUNCTION(SQLite_Receive_rotates_partitions_on_command_connection_and_waits_after_failure)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        SQLITE_SOURCE * source = test_source("a.db", "readings", test_source("b.db", "events", NULL));
+        source->partitionInterval = 86400;
+        SQLITE_CONFIG * config = test_config(source);
+        config->attach = 1;
+        std::string period = std::to_string((long long)time(NULL) / 86400);
+        openHandles = true;
+        execAnswerPattern[0] = "name GLOB 'readings_p[0-9]*'";
+        execAnswerValue[0] = period.c_str();
+        /*the view cannot be built, neither at start nor on the next command*/
+        execFailPattern = "readings (VALUE) AS ";
+
+        auto n = Module_Create(broker, config);
+        Module_Start(n);
+        openLog.clear();
+        sqlLog.clear();
+
+        ///act
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+            .IgnoreArgument(1)
+            .SetReturn("b.db");
+        Module_Receive(n, messageHandle);
+        size_t second = sqlLog.size();
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+            .IgnoreArgument(1)
+            .SetReturn("a.db");
+        Module_Receive(n, messageHandle);
+        size_t third = sqlLog.size();
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+            .IgnoreArgument(1)
+            .SetReturn("a.db");
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, "b.db\n", openLog.c_str());
+        /*only a command on the file of the source rotates it, on the connection the command uses, in the schema a.db is attached under*/
+        size_t rotation = sqlLog.find("SAVEPOINT gw_partition;");
+        ASSERT_IS_TRUE(rotation > second && rotation < third);
+        ASSERT_IS_TRUE(sqlLog.find("create table if not exists \"readings\".readings_p", rotation) < third);
+        ASSERT_IS_TRUE(sqlLog.find("CREATE VIEW \"readings\".readings (VALUE) AS ", rotation) < third);
+        ASSERT_IS_TRUE(sqlLog.find("ROLLBACK TO gw_partition;", rotation) < third);
+        /*a failed rotation is not retried by every command*/
+        ASSERT_IS_TRUE(sqlLog.find("SAVEPOINT gw_partition;", third) == std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+    //Tests_SRS_SQLITE_99_033: [ If "maintenance" is configured, the worker shall run incremental vacuum, ANALYZE and PRAGMA optimize on every database file in slices of at most sliceBudget ms once the work queues have been empty for idleTime ms. ]
+    TEST_FUNCTION(SQLite_Start_with_maintenance_does_not_rebuild_existing_file_by_default)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        SQLITE_CONFIG * config = test_config(test_source("a.db", "readings", NULL));
+        config->maintenance.interval = 3600;
+        /*a file with tables keeps its mode until it is rebuilt*/
+        execAnswerPattern[0] = "PRAGMA auto_vacuum;";
+        execAnswerValue[0] = "0";
+
+        auto n = Module_Create(broker, config);
+
+        ///act
+        Module_Start(n);
+
+        ///assert
+        ASSERT_IS_TRUE(sqlLog.find("PRAGMA auto_vacuum=INCREMENTAL;") != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("VACUUM;") == std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_033: [ If "maintenance" is configured, the worker shall run incremental vacuum, ANALYZE and PRAGMA optimize on every database file in slices of at most sliceBudget ms once the work queues have been empty for idleTime ms. ]
+    TEST_FUNCTION(SQLite_Start_with_maintenance_rebuild_vacuums_existing_file_before_init)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        SQLITE_CONFIG * config = test_config(test_source("a.db", "readings", NULL));
+        config->maintenance.interval = 3600;
+        config->maintenance.rebuild = 1;
+        execAnswerPattern[0] = "PRAGMA auto_vacuum;";
+        execAnswerValue[0] = "0";
+
+        auto n = Module_Create(broker, config);
+
+        ///act
+        Module_Start(n);
+
+        ///assert
+        size_t vacuum = sqlLog.find("\nVACUUM;");
+        ASSERT_IS_TRUE(vacuum != std::string::npos);
+        ASSERT_IS_TRUE(vacuum < sqlLog.find("BEGIN IMMEDIATE;"));
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+    //Tests_SRS_SQLITE_99_036: [ If "capture" is configured, `Sqlite_Receive` shall append the time, the properties other than credentials and the content of every message it accepts to the capture log. ]
+    TEST_FUNCTION(SQLite_Receive_captures_accepted_message_without_credentials)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        const char * path = "sqlite_ut_capture.bin";
+        unsigned char body[] = "{}";
+        SQLITE_CONFIG * config = test_config(test_source("D:\\test.db", "MODBUS", NULL));
+        config->capture = test_copy(path);
+        (void)remove(path);
+        propertyKeys[0] = "source";
+        propertyValues[0] = "mapping";
+        propertyKeys[1] = "SharedAccessKey";
+        propertyValues[1] = "secret";
+        propertyKeys[2] = "id";
+        propertyValues[2] = "7";
+        propertyCount = 3;
+        messageContent.buffer = body;
+        messageContent.size = 2;
+
+        auto n = Module_Create(broker, config);
+        Module_Start(n);
+
+        ///act
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        Module_Receive(n, messageHandle);
+        /*a message with a deviceKey is refused, and not captured either*/
+        Module_Receive(n, messageHandle);
+        Module_Destroy(n);
+
+        ///assert
+        FILE * file = fopen(path, "rb");
+        ASSERT_IS_NOT_NULL(file);
+        unsigned char log[256];
+        size_t size = fread(log, 1, sizeof(log), file);
+        fclose(file);
+        (void)remove(path);
+        /*magic, time, property count 2, content size 2, source=mapping, id=7, content*/
+        const unsigned char record[] = {
+            2, 0, 0, 0, 2, 0, 0, 0,
+            6, 0, 0, 0, 's', 'o', 'u', 'r', 'c', 'e', 7, 0, 0, 0, 'm', 'a', 'p', 'p', 'i', 'n', 'g',
+            2, 0, 0, 0, 'i', 'd', 1, 0, 0, 0, '7',
+            '{', '}' };
+        ASSERT_ARE_EQUAL(int, (int)(8 + 8 + sizeof(record)), (int)size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(log, SQLITE_CAPTURE_MAGIC, 8));
+        ASSERT_ARE_EQUAL(int, 0, memcmp(log + 16, record, sizeof(record)));
+
+        ///Cleanup
+        messageContent.buffer = NULL;
+        messageContent.size = 0;
+    }
+    //Tests_SRS_SQLITE_99_039: [ If the source of a message from another module has a "rate", `Sqlite_Receive` shall execute its command only while the source's command and byte buckets hold its cost, and otherwise drop it, reject it with an error or hold it in place of the previously held command, according to the source's "policy". ]
+    TEST_FUNCTION(SQLite_Receive_held_command_runs_with_its_own_properties)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        const char * command = "{\"sqlCommand\":\"x\"}";
+        SQLITE_SOURCE * source = test_source("D:\\test.db", "src1", NULL);
+        source->rateCommands = 1;
+        source->ratePolicy = SQLITE_RATE_COALESCE;
+        messageContent.buffer = (const unsigned char *)command;
+        messageContent.size = strlen(command);
+
+        auto n = Module_Create(broker, test_config(source));
+
+        ///act
+        /*the first command empties the bucket, the second is held and replaced by the third*/
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)NULL);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+            .IgnoreArgument(1)
+            .SetReturn("src1");
+        Module_Receive(n, messageHandle);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)NULL);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+            .IgnoreArgument(1)
+            .SetReturn("src1");
+        Module_Receive(n, messageHandle);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)NULL);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+            .IgnoreArgument(1)
+            .SetReturn("src1");
+        Module_Receive(n, messageHandle);
+        /*a second later the third runs ahead of the fourth, which is held in turn*/
+        currentTick += 1000;
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)NULL);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+            .IgnoreArgument(1)
+            .SetReturn("src1");
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        size_t first = propertiesLog.find('\n') + 1;
+        size_t second = propertiesLog.find('\n', first) + 1;
+        size_t third = propertiesLog.find('\n', second) + 1;
+        /*queued with the properties of the first and of the third message, not of the fourth that let the third run*/
+        ASSERT_ARE_EQUAL(char_ptr, (propertiesLog.substr(0, first) + propertiesLog.substr(second, third - second)).c_str(), priorityLog.c_str());
+
+        ///Cleanup
+        Module_Destroy(n);
+        messageContent.buffer = NULL;
+        messageContent.size = 0;
+    }
+
+    //Tests_SRS_SQLITE_99_039: [ If the source of a message from another module has a "rate", `Sqlite_Receive` shall execute its command only while the source's command and byte buckets hold its cost, and otherwise drop it, reject it with an error or hold it in place of the previously held command, according to the source's "policy". ]
+    TEST_FUNCTION(SQLite_Receive_rate_charges_one_command_per_message)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        /*the key written into a value is not a second command*/
+        const char * command = "{\"sqlCommand\":\"INSERT INTO t VALUES ('\\\"sqlCommand\\\"')\"}";
+        SQLITE_SOURCE * source = test_source("D:\\test.db", "src1", NULL);
+        source->rateCommands = 2;
+        source->ratePolicy = SQLITE_RATE_DROP;
+        messageContent.buffer = (const unsigned char *)command;
+        messageContent.size = strlen(command);
+        openHandles = true;
+
+        auto n = Module_Create(broker, test_config(source));
+        sqlLog.clear();
+
+        ///act
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)NULL);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+            .IgnoreArgument(1)
+            .SetReturn("src1");
+        Module_Receive(n, messageHandle);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)NULL);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+            .IgnoreArgument(1)
+            .SetReturn("src1");
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        /*two commands fit a bucket of two, whatever their content holds*/
+        size_t first = sqlLog.find("select * from MODBUS;");
+        ASSERT_IS_TRUE(first != std::string::npos);
+        ASSERT_IS_TRUE(sqlLog.find("select * from MODBUS;", first + 1) != std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+        messageContent.buffer = NULL;
+        messageContent.size = 0;
+    }
+
+    //Tests_SRS_SQLITE_JSON_99_061: [ If the configuration contains a "backpressure" object, `Sqlite_ParseConfigurationFromJson` shall read "highBacklog", "lowBacklog", "highLatency" and "lowLatency" from it. ]
+    //Tests_SRS_SQLITE_JSON_99_062: [ `Sqlite_ParseConfigurationFromJson` shall ignore "highBacklog" and "lowBacklog" unless "lanes", "maintenance", a coalescing source rate or "highLatency" start the command worker. ]
+    TEST_FUNCTION(SQLite_ParseConfigurationFromJson_backpressure_without_worker_ignores_backlog)
+    {
+        ///Arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        const char* config = "pretend this is a valid JSON string";
+        EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "backpressure"))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Object *)&fake);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "highBacklog"))
+            .IgnoreArgument(1)
+            .SetReturn("4");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "lowBacklog"))
+            .IgnoreArgument(1)
+            .SetReturn("2");
+
+        ///Act
+        SQLITE_CONFIG * n = (SQLITE_CONFIG *)Module_ParseConfigurationFromJson(config);
+
+        ///Assert
+        ASSERT_IS_NOT_NULL(n);
+        ASSERT_ARE_EQUAL(int, 0, n->backpressure.highBacklog);
+        ASSERT_ARE_EQUAL(int, 0, n->backpressure.lowBacklog);
+        ASSERT_ARE_EQUAL(int, 0, n->backpressure.highLatency);
+
+        ///Cleanup
+        Module_FreeConfiguration(n);
+    }
+
+    //Tests_SRS_SQLITE_JSON_99_062: [ `Sqlite_ParseConfigurationFromJson` shall ignore "highBacklog" and "lowBacklog" unless "lanes", "maintenance", a coalescing source rate or "highLatency" start the command worker. ]
+    TEST_FUNCTION(SQLite_ParseConfigurationFromJson_backpressure_with_highLatency_keeps_backlog)
+    {
+        ///Arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        const char* config = "pretend this is a valid JSON string";
+        EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "backpressure"))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Object *)&fake);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "highBacklog"))
+            .IgnoreArgument(1)
+            .SetReturn("4");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "lowBacklog"))
+            .IgnoreArgument(1)
+            .SetReturn("2");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "highLatency"))
+            .IgnoreArgument(1)
+            .SetReturn("100");
+
+        ///Act
+        SQLITE_CONFIG * n = (SQLITE_CONFIG *)Module_ParseConfigurationFromJson(config);
+
+        ///Assert
+        ASSERT_IS_NOT_NULL(n);
+        ASSERT_ARE_EQUAL(int, 4, n->backpressure.highBacklog);
+        ASSERT_ARE_EQUAL(int, 2, n->backpressure.lowBacklog);
+        ASSERT_ARE_EQUAL(int, 100, n->backpressure.highLatency);
+
+        ///Cleanup
+        Module_FreeConfiguration(n);
+    }
+
+    //Tests_SRS_SQLITE_JSON_99_062: [ `Sqlite_ParseConfigurationFromJson` shall ignore "highBacklog" and "lowBacklog" unless "lanes", "maintenance", a coalescing source rate or "highLatency" start the command worker. ]
+    TEST_FUNCTION(SQLite_ParseConfigurationFromJson_backpressure_with_maintenance_keeps_backlog)
+    {
+        ///Arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        const char* config = "pretend this is a valid JSON string";
+        EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "maintenance"))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Object *)&fake);
+        EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "backpressure"))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Object *)&fake);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "highBacklog"))
+            .IgnoreArgument(1)
+            .SetReturn("4");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "lowBacklog"))
+            .IgnoreArgument(1)
+            .SetReturn("2");
+
+        ///Act
+        SQLITE_CONFIG * n = (SQLITE_CONFIG *)Module_ParseConfigurationFromJson(config);
+
+        ///Assert
+        ASSERT_IS_NOT_NULL(n);
+        ASSERT_ARE_EQUAL(int, 4, n->backpressure.highBacklog);
+        ASSERT_ARE_EQUAL(int, 2, n->backpressure.lowBacklog);
+        ASSERT_ARE_EQUAL(int, 0, n->backpressure.highLatency);
+
+        ///Cleanup
+        Module_FreeConfiguration(n);
+    }
+
+    //Tests_SRS_SQLITE_JSON_99_061: [ If the configuration contains a "backpressure" object, `Sqlite_ParseConfigurationFromJson` shall read "highBacklog", "lowBacklog", "highLatency" and "lowLatency" from it. ]
+    TEST_FUNCTION(SQLite_ParseConfigurationFromJson_backpressure_with_lanes_keeps_backlog)
+    {
+        ///Arrange
+        CSQLiteMocks mocks;
+        unsigned char fake;
+        const char* config = "pretend this is a valid JSON string";
+        EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "lanes"))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Object *)&fake);
+        EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "backpressure"))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Object *)&fake);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "highBacklog"))
+            .IgnoreArgument(1)
+            .SetReturn("4");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "lowBacklog"))
+            .IgnoreArgument(1)
+            .SetReturn("2");
+
+        ///Act
+        SQLITE_CONFIG * n = (SQLITE_CONFIG *)Module_ParseConfigurationFromJson(config);
+
+        ///Assert
+        ASSERT_IS_NOT_NULL(n);
+        ASSERT_ARE_EQUAL(int, 4, n->backpressure.highBacklog);
+        ASSERT_ARE_EQUAL(int, 2, n->backpressure.lowBacklog);
+
+        ///Cleanup
+        Module_FreeConfiguration(n);
+    }
+
+    //Tests_SRS_SQLITE_99_041: [ If "backpressure" is configured, the module shall publish a "throttle" advisory naming a source when its queued commands or their average execution time reach a high watermark, and a "resume" advisory once both are back at or below the low watermarks. ]
+    TEST_FUNCTION(SQLite_Receive_backlog_publishes_throttle_and_resume)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        const char * command = "{\"sqlCommand\":\"x\"}";
+        SQLITE_CONFIG * config = test_config(test_source("D:\\test.db", "src1", NULL));
+        config->lanes[SQLITE_LANE_INGEST].weight = 1;
+        config->backpressure.highBacklog = 2;
+        messageContent.buffer = (const unsigned char *)command;
+        messageContent.size = strlen(command);
+
+        auto n = Module_Create(broker, config);
+
+        ///act
+        /*two commands queued before the worker runs reach the high watermark*/
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)NULL);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+            .IgnoreArgument(1)
+            .SetReturn("src1");
+        Module_Receive(n, messageHandle);
+        ASSERT_IS_TRUE(resultLog.find("advisory=") == std::string::npos);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)NULL);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+            .IgnoreArgument(1)
+            .SetReturn("src1");
+        Module_Receive(n, messageHandle);
+        size_t throttle = resultLog.find("advisory=throttle\nsource=src1\nbacklog=2\n");
+        ASSERT_IS_TRUE(throttle != std::string::npos);
+        /*the worker runs inline and stops at its first wait*/
+        runThreadsInline = true;
+        Module_Start(n);
+
+        ///assert
+        /*the first command run leaves one queued, which is the default low watermark*/
+        size_t resume = resultLog.find("advisory=resume\nsource=src1\nbacklog=1\n");
+        ASSERT_IS_TRUE(resume != std::string::npos);
+        ASSERT_IS_TRUE(throttle < resume);
+        ASSERT_IS_TRUE(resultLog.find("advisory=", resume + 1) == std::string::npos);
+
+        ///Cleanup
+        runThreadsInline = false;
+        Module_Destroy(n);
+        messageContent.buffer = NULL;
+        messageContent.size = 0;
+    }
+
+    //Tests_SRS_SQLITE_99_046: [ The idle worker shall count an empty queue as a command that took no time for every throttled source, so a source that went quiet is sent "resume". ]
+    TEST_FUNCTION(SQLite_Start_idle_worker_resumes_quiet_source)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        const char * command = "{\"sqlCommand\":\"x\"}";
+        SQLITE_CONFIG * config = test_config(test_source("D:\\test.db", "src1", NULL));
+        /*no lanes, the latency watermark starts the worker on its own*/
+        config->backpressure.highLatency = 50;
+        messageContent.buffer = (const unsigned char *)command;
+        messageContent.size = strlen(command);
+
+        auto n = Module_Create(broker, config);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "source"))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)NULL);
+        EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, "sqlite"))
+            .IgnoreArgument(1)
+            .SetReturn("src1");
+        Module_Receive(n, messageHandle);
+
+        ///act
+        /*the only command takes seconds, then the source sends nothing while the worker idles*/
+        tickStep = 1000;
+        waitTimeouts = 100;
+        runThreadsInline = true;
+        Module_Start(n);
+
+        ///assert
+        size_t throttle = resultLog.find("advisory=throttle\nsource=src1\n");
+        size_t resume = resultLog.find("advisory=resume\nsource=src1\nbacklog=0\n");
+        ASSERT_IS_TRUE(throttle != std::string::npos);
+        ASSERT_IS_TRUE(resume != std::string::npos);
+        ASSERT_IS_TRUE(throttle < resume);
+        ASSERT_IS_TRUE(resultLog.find("advisory=", resume + 1) == std::string::npos);
+
+        ///Cleanup
+        runThreadsInline = false;
+        Module_Destroy(n);
+        messageContent.buffer = NULL;
+        messageContent.size = 0;
+    }
+
+    //Tests_SRS_SQLITE_99_048: [ If a command runs past its "timeout", the module shall interrupt it and publish an error naming the timeout with its "requestId". ]
+    TEST_FUNCTION(SQLite_Receive_query_past_its_deadline_publishes_timeout_error)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+        openHandles = true;
+
+        auto n = Module_Create(broker, test_config(test_source("a.db", "readings", NULL)));
+        Module_Start(n);
+        resultLog.clear();
+
+        ///act
+        /*every read of the clock is 10 ms later, the progress handler sees the deadline pass*/
+        tickStep = 10;
+        progressPattern = "select * from MODBUS;";
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "dbPath"))
+            .IgnoreArgument(1)
+            .SetReturn("a.db");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "timeout"))
+            .IgnoreArgument(1)
+            .SetReturn("50");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+            .IgnoreArgument(1)
+            .SetReturn("42");
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        ASSERT_IS_TRUE(progressHandler != NULL);
+        ASSERT_IS_TRUE(resultLog.find("error=query timed out after 50 ms\nrequestId=42\n") != std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_047: [ Without the worker thread, `Sqlite_Receive` shall reject a cancel request and publish an error with its "requestId" unless it asked for no reply. ]
+    TEST_FUNCTION(SQLite_Receive_cancel_without_worker_is_rejected_with_error)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+
+        auto n = Module_Create(broker, test_config(test_source("a.db", "readings", NULL)));
+        Module_Start(n);
+        resultLog.clear();
+
+        ///act
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+            .IgnoreArgument(1)
+            .SetReturn("cancel");
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestId"))
+            .IgnoreArgument(1)
+            .SetReturn("42");
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        ASSERT_IS_TRUE(resultLog.find("error=cancel needs the command worker, configure lanes\nrequestId=42\n") != std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
+
+    //Tests_SRS_SQLITE_99_049: [ If the content of messageHandle has "requestType" set to "memory", `Sqlite_Receive` shall publish the SQLite heap use and the configured limits, and the gballoc totals only when the module is built to measure memory and gballoc was initialized. ]
+    TEST_FUNCTION(SQLite_Receive_memory_report_leaves_out_uninitialized_gballoc)
+    {
+        ///arrange
+        CSQLiteMocks mocks;
+        MESSAGE_HANDLE messageHandle = (MESSAGE_HANDLE)0x42;
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        JSON_Object * obj = (JSON_Object *)&fake;
+
+        auto n = Module_Create(broker, test_config(test_source("a.db", "readings", NULL)));
+        Module_Start(n);
+        resultLog.clear();
+
+        ///act
+        EXPECTED_CALL(mocks, ConstMap_ContainsKey(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1)
+            .SetReturn(false);
+        EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .SetReturn((JSON_Value*)malloc(1));
+        EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .SetReturn(obj);
+        EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "requestType"))
+            .IgnoreArgument(1)
+            .SetReturn("memory");
+        EXPECTED_CALL(mocks, gballoc_getCurrentMemoryUsed())
+            .SetReturn(SIZE_MAX);
+        Module_Receive(n, messageHandle);
+
+        ///assert
+        ASSERT_IS_TRUE(resultLog.find("memory.sqliteUsed=") != std::string::npos);
+        ASSERT_IS_TRUE(resultLog.find("memory.gballoc") == std::string::npos);
+
+        ///Cleanup
+        Module_Destroy(n);
+    }
 END_TEST_SUITE(sqlite_ut)
@@ -0,0 +1,376 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/platform.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/map.h"
+#include "parson.h"
+#include "broker.h"
+#include "message.h"
+#include "module.h"
+#include "sqlite.h"
+
+/*replays a capture log written by the sqlite module's "capture" option against a module created
+  from the same args, at the original pace or faster, and reports how long Module_Receive took*/
+
+typedef struct REPLAY_STATS_TAG
+{
+    uint64_t * latencies;
+    size_t count;
+    size_t capacity;
+    uint64_t max_lag;
+} REPLAY_STATS;
+
+static uint64_t replay_now(void)
+{
+#ifdef _MSC_VER
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    (void)QueryPerformanceFrequency(&frequency);
+    (void)QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+#endif
+}
+
+static int replay_read_u32(FILE * log, uint32_t * value)
+{
+    unsigned char bytes[4];
+    int result;
+    if (fread(bytes, 1, sizeof(bytes), log) != sizeof(bytes))
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        *value = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+        result = 0;
+    }
+    return result;
+}
+
+/*reads a size prefixed string, NUL terminated for Map_AddOrUpdate*/
+static char * replay_read_string(FILE * log)
+{
+    char * result;
+    uint32_t size;
+    if (replay_read_u32(log, &size) != 0)
+    {
+        result = NULL;
+    }
+    else if ((result = (char *)malloc((size_t)size + 1)) == NULL)
+    {
+        LogError("unable to allocate %u bytes", size);
+    }
+    else if (fread(result, 1, size, log) != size)
+    {
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        result[size] = '\0';
+    }
+    return result;
+}
+
+/*builds the message of one record, NULL at the end of the log or on a truncated record*/
+static MESSAGE_HANDLE replay_read_message(FILE * log)
+{
+    MESSAGE_HANDLE result = NULL;
+    uint32_t property_count;
+    uint32_t content_size;
+    if (replay_read_u32(log, &property_count) != 0 || replay_read_u32(log, &content_size) != 0)
+    {
+        LogError("truncated record");
+    }
+    else
+    {
+        MAP_HANDLE properties = Map_Create(NULL);
+        if (properties == NULL)
+        {
+            LogError("unable to create the properties map");
+        }
+        else
+        {
+            unsigned char * content = NULL;
+            uint32_t index;
+            int failed = 0;
+            for (index = 0; index < property_count && failed == 0; index++)
+            {
+                char * key = replay_read_string(log);
+                char * value = (key == NULL) ? NULL : replay_read_string(log);
+                if (value == NULL || Map_AddOrUpdate(properties, key, value) != MAP_OK)
+                {
+                    LogError("unable to read property %u", index);
+                    failed = 1;
+                }
+                free(key);
+                free(value);
+            }
+            if (failed == 0 && content_size > 0 &&
+                ((content = (unsigned char *)malloc(content_size)) == NULL || fread(content, 1, content_size, log) != content_size))
+            {
+                LogError("unable to read %u bytes of content", content_size);
+                failed = 1;
+            }
+            if (failed == 0)
+            {
+                MESSAGE_CONFIG config;
+                config.size = content_size;
+                config.source = content;
+                config.sourceProperties = properties;
+                if ((result = Message_Create(&config)) == NULL)
+                {
+                    LogError("unable to create the message");
+                }
+            }
+            free(content);
+            Map_Destroy(properties);
+        }
+    }
+    return result;
+}
+
+static int replay_record(REPLAY_STATS * stats, uint64_t latency, uint64_t lag)
+{
+    int result = 0;
+    if (stats->count == stats->capacity)
+    {
+        size_t capacity = (stats->capacity == 0) ? 1024 : stats->capacity * 2;
+        uint64_t * latencies = (uint64_t *)realloc(stats->latencies, capacity * sizeof(uint64_t));
+        if (latencies == NULL)
+        {
+            LogError("unable to keep %zu latencies", capacity);
+            result = __LINE__;
+        }
+        else
+        {
+            stats->latencies = latencies;
+            stats->capacity = capacity;
+        }
+    }
+    if (result == 0)
+    {
+        stats->latencies[stats->count++] = latency;
+        if (lag > stats->max_lag)
+        {
+            stats->max_lag = lag;
+        }
+    }
+    return result;
+}
+
+static int replay_compare(const void * left, const void * right)
+{
+    uint64_t a = *(const uint64_t *)left;
+    uint64_t b = *(const uint64_t *)right;
+    return (a > b) - (a < b);
+}
+
+static uint64_t replay_percentile(const REPLAY_STATS * stats, int percent)
+{
+    size_t rank = (stats->count * (size_t)percent + 99) / 100;
+    return stats->latencies[(rank == 0) ? 0 : rank - 1];
+}
+
+static void replay_report(REPLAY_STATS * stats, uint64_t elapsed)
+{
+    printf("replayed %zu messages in %.3f s", stats->count, (double)elapsed / 1000000);
+    if (elapsed > 0)
+    {
+        printf(", %.1f messages/s", (double)stats->count * 1000000 / (double)elapsed);
+    }
+    printf("\n");
+    if (stats->count > 0)
+    {
+        qsort(stats->latencies, stats->count, sizeof(uint64_t), replay_compare);
+        printf("Module_Receive us: p50 %llu, p90 %llu, p99 %llu, max %llu\n",
+            (unsigned long long)replay_percentile(stats, 50), (unsigned long long)replay_percentile(stats, 90),
+            (unsigned long long)replay_percentile(stats, 99), (unsigned long long)stats->latencies[stats->count - 1]);
+        printf("largest lag behind the captured schedule: %llu ms\n", (unsigned long long)(stats->max_lag / 1000));
+    }
+    printf("with lanes configured Module_Receive only queues commands, replay without \"lanes\" in the args to time their execution\n");
+}
+
+/*the args of the module named "sqlite" when the file is a gateway configuration, otherwise the whole file*/
+static char * replay_read_args(const char * path)
+{
+    char * result = NULL;
+    JSON_Value * root = json_parse_file(path);
+    if (root == NULL)
+    {
+        LogError("unable to parse %s", path);
+    }
+    else
+    {
+        JSON_Value * args = root;
+        JSON_Array * modules = json_object_get_array(json_value_get_object(root), "modules");
+        if (modules != NULL)
+        {
+            size_t index;
+            args = NULL;
+            for (index = 0; index < json_array_get_count(modules); index++)
+            {
+                JSON_Object * module = json_array_get_object(modules, index);
+                const char * name = json_object_get_string(module, "name");
+                if (name != NULL && strcmp(name, "sqlite") == 0)
+                {
+                    args = json_object_get_value(module, "args");
+                    break;
+                }
+            }
+        }
+        if (args == NULL)
+        {
+            LogError("%s has no module named \"sqlite\" with args", path);
+        }
+        else
+        {
+            result = json_serialize_to_string(args);
+        }
+        json_value_free(root);
+    }
+    return result;
+}
+
+static int replay(const MODULE_API_1 * api, MODULE_HANDLE module, FILE * log, double speed)
+{
+    int result = 0;
+    REPLAY_STATS stats = { NULL, 0, 0, 0 };
+    uint64_t started = replay_now();
+    uint64_t base = started;
+    unsigned char head[SQLITE_CAPTURE_MAGIC_SIZE];
+    size_t read;
+    while (result == 0 && (read = fread(head, 1, sizeof(head), log)) == sizeof(head))
+    {
+        if (memcmp(head, SQLITE_CAPTURE_MAGIC, SQLITE_CAPTURE_MAGIC_SIZE) == 0)
+        {
+            /*each time the module opened the log the offsets start again*/
+            base = replay_now();
+        }
+        else
+        {
+            uint64_t offset = 0;
+            uint64_t due;
+            uint64_t now;
+            MESSAGE_HANDLE message;
+            int byte;
+            for (byte = 7; byte >= 0; byte--)
+            {
+                offset = (offset << 8) | head[byte];
+            }
+            due = base + ((speed > 0) ? (uint64_t)((double)offset / speed) : 0);
+            if (speed > 0 && (now = replay_now()) < due)
+            {
+                ThreadAPI_Sleep((unsigned int)((due - now) / 1000));
+            }
+            if ((message = replay_read_message(log)) == NULL)
+            {
+                result = __LINE__;
+            }
+            else
+            {
+                uint64_t received = replay_now();
+                api->Module_Receive(module, message);
+                now = replay_now();
+                result = replay_record(&stats, now - received, (speed > 0 && received > due) ? received - due : 0);
+                Message_Destroy(message);
+            }
+        }
+    }
+    if (result == 0 && read != 0)
+    {
+        LogError("truncated record at the end of the log");
+    }
+    replay_report(&stats, replay_now() - started);
+    free(stats.latencies);
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result = 1;
+    if (argc != 3 && argc != 4)
+    {
+        printf("usage: sqlite_replay argsFile captureFile [speed]\n");
+        printf("where argsFile holds the sqlite module args, or a gateway configuration with a module named \"sqlite\",\n");
+        printf("captureFile is a log written by the module's \"capture\" option\n");
+        printf("and speed is 1 for the captured pace (default), N for N times faster or 0 for as fast as possible\n");
+    }
+    else if (platform_init() != 0)
+    {
+        LogError("Failed to initialize the platform.");
+    }
+    else
+    {
+        double speed = (argc == 4) ? atof(argv[3]) : 1;
+        char * args = replay_read_args(argv[1]);
+        FILE * log = fopen(argv[2], "rb");
+        unsigned char magic[SQLITE_CAPTURE_MAGIC_SIZE];
+        if (args == NULL)
+        {
+            /*already logged*/
+        }
+        else if (log == NULL || fread(magic, 1, sizeof(magic), log) != sizeof(magic) ||
+            memcmp(magic, SQLITE_CAPTURE_MAGIC, SQLITE_CAPTURE_MAGIC_SIZE) != 0)
+        {
+            LogError("%s is not a capture log", argv[2]);
+        }
+        else
+        {
+            const MODULE_API_1 * api = (const MODULE_API_1 *)MODULE_STATIC_GETAPI(SQLITE_MODULE)(MODULE_API_VERSION_1);
+            void * configuration = api->Module_ParseConfigurationFromJson(args);
+            BROKER_HANDLE broker;
+            if (configuration == NULL)
+            {
+                LogError("unable to parse the module args");
+            }
+            else if ((broker = Broker_Create()) == NULL)
+            {
+                LogError("unable to create the broker");
+                api->Module_FreeConfiguration(configuration);
+            }
+            else
+            {
+                MODULE_HANDLE module = api->Module_Create(broker, configuration);
+                if (module == NULL)
+                {
+                    LogError("unable to create the module");
+                }
+                else
+                {
+                    if (api->Module_Start != NULL)
+                    {
+                        api->Module_Start(module);
+                    }
+                    result = (replay(api, module, log, speed) == 0) ? 0 : 1;
+                    api->Module_Destroy(module);
+                }
+                api->Module_FreeConfiguration(configuration);
+                Broker_Destroy(broker);
+            }
+        }
+        if (log != NULL)
+        {
+            (void)fclose(log);
+        }
+        json_free_serialized_string(args);
+        platform_deinit();
+    }
+    return result;
+}